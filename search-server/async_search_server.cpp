@@ -0,0 +1,141 @@
+#include <algorithm>
+#include <execution>
+#include <utility>
+
+#include "async_search_server.h"
+
+using namespace std::string_literals;
+
+AsyncSearchServer::AsyncSearchServer(const SearchServer& search_server, AsyncSearchOptions options)
+    : search_server_(search_server)
+    , max_queue_size_(options.max_queue_size) {
+    size_t worker_count = options.worker_count;
+    if (worker_count == 0) {
+        worker_count = std::max(1u, std::thread::hardware_concurrency());
+    }
+    workers_.reserve(worker_count);
+    try {
+        for (size_t i = 0; i < worker_count; ++i) {
+            workers_.emplace_back([this] {
+                WorkerLoop();
+            });
+        }
+    } catch (...) {
+        Stop();
+        throw;
+    }
+}
+
+AsyncSearchServer::~AsyncSearchServer() {
+    Stop();
+}
+
+std::future<std::vector<Document>> AsyncSearchServer::Submit(std::string raw_query, DocumentStatus status, int max_result_count,
+    Clock::time_point deadline) {
+    Request request{std::move(raw_query), status, max_result_count, deadline, Clock::now(), {}};
+    std::future<std::vector<Document>> result = request.promise.get_future();
+    bool is_accepted = false;
+    bool is_stopping = false;
+    {
+        std::lock_guard lock(mutex_);
+        is_stopping = stop_;
+        if (!stop_ && queue_.size() < max_queue_size_) {
+            queue_.push_back(std::move(request));
+            is_accepted = true;
+            ++stats_.accepted;
+            stats_.max_queue_depth = std::max(stats_.max_queue_depth, queue_.size());
+        } else {
+            ++stats_.rejected;
+        }
+    }
+    if (is_accepted) {
+        queue_not_empty_.notify_one();
+    } else {
+        const std::string message = is_stopping ? "Search server is stopping"s : "Search queue is full"s;
+        request.promise.set_exception(std::make_exception_ptr(QueryRejectedError(message)));
+    }
+    return result;
+}
+
+std::future<std::vector<Document>> AsyncSearchServer::Submit(std::string raw_query, Clock::time_point deadline) {
+    return Submit(std::move(raw_query), DocumentStatus::ACTUAL, MAX_RESULT_DOCUMENT_COUNT, deadline);
+}
+
+std::future<std::vector<Document>> AsyncSearchServer::Submit(std::string raw_query) {
+    return Submit(std::move(raw_query), Clock::time_point::max());
+}
+
+size_t AsyncSearchServer::GetWorkerCount() const {
+    return workers_.size();
+}
+
+AsyncSearchStats AsyncSearchServer::GetStats() const {
+    std::lock_guard lock(mutex_);
+    AsyncSearchStats stats = stats_;
+    stats.queue_depth = queue_.size();
+    return stats;
+}
+
+//workers finish the accepted requests before they return
+void AsyncSearchServer::Stop() {
+    {
+        std::lock_guard lock(mutex_);
+        stop_ = true;
+    }
+    queue_not_empty_.notify_all();
+    for (std::thread& worker : workers_) {
+        if (worker.joinable()) {
+            worker.join();
+        }
+    }
+}
+
+void AsyncSearchServer::WorkerLoop() {
+    while (true) {
+        Request request;
+        {
+            std::unique_lock lock(mutex_);
+            queue_not_empty_.wait(lock, [this] {
+                return stop_ || !queue_.empty();
+            });
+            if (queue_.empty()) {
+                return;
+            }
+            request = std::move(queue_.front());
+            queue_.pop_front();
+            const Clock::time_point now = Clock::now();
+            const auto wait_time = std::chrono::duration_cast<std::chrono::microseconds>(now - request.submit_time);
+            stats_.total_wait_time += wait_time;
+            stats_.max_wait_time = std::max(stats_.max_wait_time, wait_time);
+            if (now > request.deadline) {
+                ++stats_.expired;
+                request.promise.set_exception(std::make_exception_ptr(QueryDeadlineError("Query deadline passed in the queue"s)));
+                continue;
+            }
+        }
+        Run(request);
+    }
+}
+
+//stats are updated before the result is set, so they already count the request when its future is ready
+void AsyncSearchServer::Run(Request& request) {
+    std::vector<Document> documents;
+    std::exception_ptr exception;
+    try {
+        documents = search_server_.FindTopDocuments(std::execution::seq, request.raw_query, request.status, request.max_result_count);
+    } catch (...) {
+        exception = std::current_exception();
+    }
+    {
+        std::lock_guard lock(mutex_);
+        ++stats_.completed;
+        if (exception) {
+            ++stats_.failed;
+        }
+    }
+    if (exception) {
+        request.promise.set_exception(exception);
+    } else {
+        request.promise.set_value(std::move(documents));
+    }
+}
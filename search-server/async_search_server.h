@@ -0,0 +1,103 @@
+#pragma once
+
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <future>
+#include <mutex>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "search_server.h"
+
+struct AsyncSearchOptions {
+    // 0 means one worker per hardware thread
+    size_t worker_count = 0;
+    // requests waiting for a worker, new requests are rejected while the queue is full
+    size_t max_queue_size = 1024;
+};
+
+struct AsyncSearchStats {
+    size_t queue_depth = 0;
+    size_t max_queue_depth = 0;
+    uint64_t accepted = 0;
+    uint64_t rejected = 0;
+    // accepted requests whose deadline passed before a worker took them
+    uint64_t expired = 0;
+    uint64_t completed = 0;
+    // completed requests whose query threw, e.g. an invalid query
+    uint64_t failed = 0;
+    // time the requests taken by workers spent in the queue
+    std::chrono::microseconds total_wait_time{0};
+    std::chrono::microseconds max_wait_time{0};
+};
+
+// Set in the future of a request which was not accepted. The message tells "Search queue is full"
+// from "Search server is stopping", a request submitted while the server is being destroyed
+class QueryRejectedError : public std::runtime_error {
+public:
+    using std::runtime_error::runtime_error;
+};
+
+// Set in the future of a request whose deadline passed while it waited in the queue
+class QueryDeadlineError : public std::runtime_error {
+public:
+    using std::runtime_error::runtime_error;
+};
+
+// Asynchronous front end of a SearchServer. Submit never blocks: the query is put into a bounded
+// queue and run by one of the workers, the results come through the returned future. Under overload
+// new requests fail at once instead of piling up, and requests which waited past their deadline
+// are dropped without being run, so the queue drains quickly after a load spike
+class AsyncSearchServer {
+public:
+    using Clock = std::chrono::steady_clock;
+
+    // search_server must outlive this object and must not be modified while requests are running
+    explicit AsyncSearchServer(const SearchServer& search_server, AsyncSearchOptions options = {});
+    AsyncSearchServer(const AsyncSearchServer&) = delete;
+    AsyncSearchServer& operator=(const AsyncSearchServer&) = delete;
+
+    // Runs the accepted requests and stops the workers
+    ~AsyncSearchServer();
+
+    // A running query is not interrupted by its deadline
+    std::future<std::vector<Document>> Submit(std::string raw_query, DocumentStatus status, int max_result_count,
+        Clock::time_point deadline);
+
+    std::future<std::vector<Document>> Submit(std::string raw_query, Clock::time_point deadline);
+
+    std::future<std::vector<Document>> Submit(std::string raw_query);
+
+    size_t GetWorkerCount() const;
+
+    AsyncSearchStats GetStats() const;
+
+private:
+    struct Request {
+        std::string raw_query;
+        DocumentStatus status = DocumentStatus::ACTUAL;
+        int max_result_count = 0;
+        Clock::time_point deadline;
+        Clock::time_point submit_time;
+        std::promise<std::vector<Document>> promise;
+    };
+
+    const SearchServer& search_server_;
+    size_t max_queue_size_;
+    std::vector<std::thread> workers_;
+    mutable std::mutex mutex_;
+    std::condition_variable queue_not_empty_;
+    std::deque<Request> queue_;
+    AsyncSearchStats stats_;
+    bool stop_ = false;
+
+    void Stop();
+
+    void WorkerLoop();
+
+    void Run(Request& request);
+};
@@ -1,46 +1,180 @@
 #pragma once
 
-using namespace std::string_literals;
+#include <vector>
+#include <map>
+#include <mutex>
+#include <optional>
+#include <utility>
+#include <algorithm>
+#include <functional>
+#include <type_traits>
+#include <cstddef>
+#include <cstdint>
 
-template <typename Key, typename Value>
+// Hash map for concurrent updates. Keys are spread between buckets by hash, every bucket is
+// an open addressing table with its own mutex and takes whole cache lines, so threads working
+// on different buckets don't contend for the same line. Access keeps the bucket locked while the
+// value is used; values of a bucket may move when it grows, but only under the bucket lock
+template <typename Key, typename Value, typename Hash = std::hash<Key>>
 class ConcurrentMap {
 private:
-    struct Bucket {
+    static constexpr size_t CACHE_LINE_SIZE = 64;
+    static constexpr size_t MIN_BUCKET_CAPACITY = 8;
+
+    struct alignas(CACHE_LINE_SIZE) Bucket {
         std::mutex mutex;
-        std::map<Key, Value> map;
+        //size is a power of two, at most half of the slots are used
+        std::vector<std::optional<std::pair<Key, Value>>> slots;
+        size_t size = 0;
+        //64 - log2(slots.size()), see GetSlotIndex
+        int slot_shift = 64;
+
+        Value& Get(const Key& key, size_t hash);
+
+        void Reserve(size_t count);
     };
- 
+
 public:
-    static_assert(std::is_integral_v<Key>, "ConcurrentMap supports only integer keys"s);
- 
     struct Access {
         std::lock_guard<std::mutex> guard;
         Value& ref_to_value;
- 
-        Access(const Key& key, Bucket& bucket)
+
+        Access(const Key& key, size_t hash, Bucket& bucket)
             : guard(bucket.mutex)
-            , ref_to_value(bucket.map[key]) {
+            , ref_to_value(bucket.Get(key, hash)) {
         }
     };
- 
-    explicit ConcurrentMap(size_t bucket_count)
-        : buckets_(bucket_count) {
+
+    // expected_size is a hint of the number of keys, the buckets are sized for it up front
+    explicit ConcurrentMap(size_t bucket_count, size_t expected_size = 0)
+        : buckets_(std::max<size_t>(bucket_count, 1)) {
+        Reserve(expected_size);
     }
- 
+
     Access operator[](const Key& key) {
-        auto& bucket = buckets_[static_cast<uint64_t>(key) % buckets_.size()];
-        return {key, bucket};
+        const size_t hash = GetHash(key);
+        return {key, hash, buckets_[GetBucketIndex(hash)]};
+    }
+
+    // Adds delta to the value of the key under a single short lock
+    template <typename Delta, typename V = Value, typename = std::enable_if_t<std::is_arithmetic_v<V>>>
+    void Add(const Key& key, Delta delta) {
+        const size_t hash = GetHash(key);
+        Bucket& bucket = buckets_[GetBucketIndex(hash)];
+        std::lock_guard guard(bucket.mutex);
+        bucket.Get(key, hash) += delta;
+    }
+
+    void Reserve(size_t expected_size) {
+        const size_t bucket_size = (expected_size + buckets_.size() - 1) / buckets_.size();
+        for (Bucket& bucket : buckets_) {
+            std::lock_guard guard(bucket.mutex);
+            bucket.Reserve(bucket_size);
+        }
+    }
+
+    size_t size() {
+        size_t result = 0;
+        for (Bucket& bucket : buckets_) {
+            std::lock_guard guard(bucket.mutex);
+            result += bucket.size;
+        }
+        return result;
+    }
+
+    // Moves the content out sorted by key and leaves the map empty
+    std::vector<std::pair<Key, Value>> ExtractSorted() {
+        std::vector<std::pair<Key, Value>> result;
+        for (Bucket& bucket : buckets_) {
+            std::lock_guard guard(bucket.mutex);
+            for (auto& slot : bucket.slots) {
+                if (slot) {
+                    result.push_back(std::move(*slot));
+                }
+            }
+            bucket.slots.clear();
+            bucket.size = 0;
+        }
+        std::sort(result.begin(), result.end(), [](const auto& lhs, const auto& rhs) {
+            return lhs.first < rhs.first;
+        });
+        return result;
     }
- 
+
     std::map<Key, Value> BuildOrdinaryMap() {
         std::map<Key, Value> result;
-        for (auto& [mutex, map] : buckets_) {
-            std::lock_guard g(mutex);
-            result.insert(map.begin(), map.end());
+        for (Bucket& bucket : buckets_) {
+            std::lock_guard guard(bucket.mutex);
+            for (const auto& slot : bucket.slots) {
+                if (slot) {
+                    result.insert(*slot);
+                }
+            }
         }
         return result;
     }
- 
+
 private:
     std::vector<Bucket> buckets_;
-};
\ No newline at end of file
+
+    // Fibonacci hashing mixes the hash, so identity hashes of integers are spread well too
+    static size_t GetHash(const Key& key) {
+        return static_cast<uint64_t>(Hash{}(key)) * 0x9E3779B97F4A7C15ull;
+    }
+
+    // the high half of the hash chooses the bucket, the top bits of the low half choose the slot in it.
+    // Low bits of the product keep the trailing zeros of the key, so strided keys would all get the same slot
+    size_t GetBucketIndex(size_t hash) const {
+        return (hash >> 32) % buckets_.size();
+    }
+
+    static size_t GetSlotIndex(size_t hash, int slot_shift) {
+        return (static_cast<uint64_t>(hash) << 32) >> slot_shift;
+    }
+};
+
+template <typename Key, typename Value, typename Hash>
+Value& ConcurrentMap<Key, Value, Hash>::Bucket::Get(const Key& key, size_t hash) {
+    if ((size + 1) * 2 > slots.size()) {
+        Reserve(size + 1);
+    }
+    const size_t mask = slots.size() - 1;
+    for (size_t index = ConcurrentMap::GetSlotIndex(hash, slot_shift);; index = (index + 1) & mask) {
+        auto& slot = slots[index];
+        if (!slot) {
+            slot.emplace(key, Value());
+            ++size;
+            return slot->second;
+        }
+        if (slot->first == key) {
+            return slot->second;
+        }
+    }
+}
+
+template <typename Key, typename Value, typename Hash>
+void ConcurrentMap<Key, Value, Hash>::Bucket::Reserve(size_t count) {
+    size_t capacity = 1;
+    int capacity_log = 0;
+    while (capacity < MIN_BUCKET_CAPACITY || capacity < count * 2) {
+        capacity *= 2;
+        ++capacity_log;
+    }
+    if (capacity <= slots.size()) {
+        return;
+    }
+    std::vector<std::optional<std::pair<Key, Value>>> old_slots(capacity);
+    old_slots.swap(slots);
+    slot_shift = 64 - capacity_log;
+    const size_t mask = capacity - 1;
+    for (auto& old_slot : old_slots) {
+        if (!old_slot) {
+            continue;
+        }
+        size_t index = ConcurrentMap::GetSlotIndex(ConcurrentMap::GetHash(old_slot->first), slot_shift);
+        while (slots[index]) {
+            index = (index + 1) & mask;
+        }
+        slots[index] = std::move(old_slot);
+    }
+}
@@ -9,6 +9,8 @@ enum class DocumentStatus {
     REMOVED,
 };
 
+static const int DOCUMENT_STATUS_COUNT = 4;
+
 
 struct Document {
     Document();
@@ -0,0 +1,151 @@
+#include "document_id_set.h"
+
+DocumentIdSet::DocumentIdSet(std::vector<int> document_ids) {
+    if (!std::is_sorted(document_ids.begin(), document_ids.end())) {
+        std::sort(document_ids.begin(), document_ids.end());
+    }
+    document_ids.erase(std::unique(document_ids.begin(), document_ids.end()), document_ids.end());
+    size_ = document_ids.size();
+
+    for (size_t begin = 0, end = 0; begin < document_ids.size(); begin = end) {
+        const uint32_t key = static_cast<uint32_t>(document_ids[begin]) >> CHUNK_BITS;
+        for (end = begin + 1; end < document_ids.size() && static_cast<uint32_t>(document_ids[end]) >> CHUNK_BITS == key; ++end) {
+        }
+        Chunk chunk;
+        chunk.key = key;
+        chunk.size = end - begin;
+        if (end - begin <= ARRAY_CHUNK_MAX_SIZE) {
+            chunk.values.reserve(end - begin);
+            for (size_t i = begin; i < end; ++i) {
+                chunk.values.push_back(static_cast<uint16_t>(document_ids[i]));
+            }
+        } else {
+            chunk.bits.assign(CHUNK_SIZE / 64, 0);
+            for (size_t i = begin; i < end; ++i) {
+                const uint16_t low = static_cast<uint16_t>(document_ids[i]);
+                chunk.bits[low / 64] |= uint64_t{1} << (low % 64);
+            }
+        }
+        chunks_.push_back(std::move(chunk));
+    }
+}
+
+bool DocumentIdSet::Contains(int document_id) const {
+    if (document_id < 0) {
+        return false;
+    }
+    const Chunk* chunk = FindChunk(static_cast<uint32_t>(document_id) >> CHUNK_BITS);
+    if (chunk == nullptr) {
+        return false;
+    }
+    const uint16_t low = static_cast<uint16_t>(document_id);
+    if (chunk->bits.empty()) {
+        return std::binary_search(chunk->values.begin(), chunk->values.end(), low);
+    }
+    return (chunk->bits[low / 64] >> (low % 64)) & 1;
+}
+
+bool DocumentIdSet::Insert(int document_id) {
+    const uint32_t key = static_cast<uint32_t>(document_id) >> CHUNK_BITS;
+    const uint16_t low = static_cast<uint16_t>(document_id);
+    auto chunk = std::lower_bound(chunks_.begin(), chunks_.end(), key,
+        [](const Chunk& candidate, uint32_t target_key) {
+            return candidate.key < target_key;
+        });
+    if (chunk == chunks_.end() || chunk->key != key) {
+        chunk = chunks_.insert(chunk, Chunk{key, 0, {}, {}});
+    }
+    if (chunk->bits.empty()) {
+        const auto it = std::lower_bound(chunk->values.begin(), chunk->values.end(), low);
+        if (it != chunk->values.end() && *it == low) {
+            return false;
+        }
+        chunk->values.insert(it, low);
+    } else {
+        uint64_t& word = chunk->bits[low / 64];
+        const uint64_t bit = uint64_t{1} << (low % 64);
+        if (word & bit) {
+            return false;
+        }
+        word |= bit;
+    }
+    ++chunk->size;
+    ++size_;
+    if (chunk->bits.empty() && chunk->size > ARRAY_CHUNK_MAX_SIZE) {
+        ConvertToBitmap(*chunk);
+    }
+    return true;
+}
+
+bool DocumentIdSet::Erase(int document_id) {
+    if (document_id < 0) {
+        return false;
+    }
+    const uint32_t key = static_cast<uint32_t>(document_id) >> CHUNK_BITS;
+    const uint16_t low = static_cast<uint16_t>(document_id);
+    const auto chunk = std::lower_bound(chunks_.begin(), chunks_.end(), key,
+        [](const Chunk& candidate, uint32_t target_key) {
+            return candidate.key < target_key;
+        });
+    if (chunk == chunks_.end() || chunk->key != key) {
+        return false;
+    }
+    if (chunk->bits.empty()) {
+        const auto it = std::lower_bound(chunk->values.begin(), chunk->values.end(), low);
+        if (it == chunk->values.end() || *it != low) {
+            return false;
+        }
+        chunk->values.erase(it);
+    } else {
+        uint64_t& word = chunk->bits[low / 64];
+        const uint64_t bit = uint64_t{1} << (low % 64);
+        if (!(word & bit)) {
+            return false;
+        }
+        word &= ~bit;
+    }
+    --chunk->size;
+    --size_;
+    if (chunk->size == 0) {
+        chunks_.erase(chunk);
+    } else if (!chunk->bits.empty() && chunk->size <= ARRAY_CHUNK_MAX_SIZE / 2) {
+        // the margin keeps a chunk near the limit from switching on every change
+        ConvertToArray(*chunk);
+    }
+    return true;
+}
+
+size_t DocumentIdSet::size() const {
+    return size_;
+}
+
+bool DocumentIdSet::empty() const {
+    return size_ == 0;
+}
+
+const DocumentIdSet::Chunk* DocumentIdSet::FindChunk(uint32_t key) const {
+    const auto it = std::lower_bound(chunks_.begin(), chunks_.end(), key,
+        [](const Chunk& candidate, uint32_t target_key) {
+            return candidate.key < target_key;
+        });
+    return it != chunks_.end() && it->key == key ? &*it : nullptr;
+}
+
+void DocumentIdSet::ConvertToBitmap(Chunk& chunk) {
+    chunk.bits.assign(CHUNK_SIZE / 64, 0);
+    for (uint16_t low : chunk.values) {
+        chunk.bits[low / 64] |= uint64_t{1} << (low % 64);
+    }
+    std::vector<uint16_t>().swap(chunk.values);
+}
+
+void DocumentIdSet::ConvertToArray(Chunk& chunk) {
+    chunk.values.clear();
+    chunk.values.reserve(chunk.size);
+    for (uint32_t word_index = 0; word_index < chunk.bits.size(); ++word_index) {
+        for (uint64_t word = chunk.bits[word_index]; word != 0; word &= word - 1) {
+            chunk.values.push_back(static_cast<uint16_t>(word_index * 64 + __builtin_ctzll(word)));
+        }
+    }
+    std::vector<uint64_t>().swap(chunk.bits);
+}
@@ -0,0 +1,93 @@
+#pragma once
+
+#include <vector>
+#include <cstddef>
+#include <cstdint>
+#include <algorithm>
+
+// Set of non-negative document ids. Ids are split into chunks of 2^16 consecutive ids;
+// a chunk keeps the low 16 bits of its ids in a sorted array, or in a bitmap once it
+// holds more than ARRAY_CHUNK_MAX_SIZE ids, so dense and sparse sets both stay compact
+class DocumentIdSet {
+public:
+    static constexpr size_t ARRAY_CHUNK_MAX_SIZE = 4096;
+
+    DocumentIdSet() = default;
+
+    // ids may come in any order and repeat
+    explicit DocumentIdSet(std::vector<int> document_ids);
+
+    bool Contains(int document_id) const;
+
+    // Returns false if the id is already in the set
+    bool Insert(int document_id);
+
+    // Returns false if there is no such id in the set
+    bool Erase(int document_id);
+
+    size_t size() const;
+
+    bool empty() const;
+
+    // Calls func for the ids in [begin, end) in increasing order
+    template <typename Func>
+    void ForEachInRange(int64_t begin, int64_t end, Func func) const;
+
+private:
+    static constexpr int CHUNK_BITS = 16;
+    static constexpr uint32_t CHUNK_SIZE = uint32_t{1} << CHUNK_BITS;
+
+    struct Chunk {
+        uint32_t key;
+        uint32_t size;
+        std::vector<uint16_t> values; // sorted low bits, used while the chunk is small
+        std::vector<uint64_t> bits;   // CHUNK_SIZE bits, used for large chunks
+    };
+
+    std::vector<Chunk> chunks_;
+    size_t size_ = 0;
+
+    const Chunk* FindChunk(uint32_t key) const;
+
+    static void ConvertToBitmap(Chunk& chunk);
+
+    static void ConvertToArray(Chunk& chunk);
+};
+
+template <typename Func>
+void DocumentIdSet::ForEachInRange(int64_t begin, int64_t end, Func func) const {
+    begin = std::max<int64_t>(begin, 0);
+    if (begin >= end) {
+        return;
+    }
+    auto chunk = std::lower_bound(chunks_.begin(), chunks_.end(), static_cast<uint32_t>(begin >> CHUNK_BITS),
+        [](const Chunk& candidate, uint32_t target_key) {
+            return candidate.key < target_key;
+        });
+    for (; chunk != chunks_.end() && (int64_t{chunk->key} << CHUNK_BITS) < end; ++chunk) {
+        const int64_t chunk_begin = int64_t{chunk->key} << CHUNK_BITS;
+        const uint32_t low_begin = static_cast<uint32_t>(std::max(begin, chunk_begin) - chunk_begin);
+        const uint32_t low_end = static_cast<uint32_t>(std::min<int64_t>(end - chunk_begin, CHUNK_SIZE));
+        if (chunk->bits.empty()) {
+            for (auto it = std::lower_bound(chunk->values.begin(), chunk->values.end(), low_begin);
+                it != chunk->values.end() && *it < low_end; ++it) {
+                func(static_cast<int>(chunk_begin + *it));
+            }
+            continue;
+        }
+        for (uint32_t word_index = low_begin / 64; word_index * 64 < low_end; ++word_index) {
+            uint64_t word = chunk->bits[word_index];
+            if (word_index == low_begin / 64) {
+                word &= ~uint64_t{0} << (low_begin % 64);
+            }
+            if ((word_index + 1) * 64 > low_end) {
+                word &= ~(~uint64_t{0} << (low_end % 64));
+            }
+            while (word != 0) {
+                const int bit = __builtin_ctzll(word);
+                func(static_cast<int>(chunk_begin + word_index * 64 + bit));
+                word &= word - 1;
+            }
+        }
+    }
+}
@@ -0,0 +1,184 @@
+#include <cstring>
+
+#include "posting_codec.h"
+
+#if (defined(__GNUC__) || defined(__clang__)) && (defined(__x86_64__) || defined(__i386__))
+#define POSTING_CODEC_X86_DISPATCH
+#include <immintrin.h>
+#endif
+
+namespace {
+
+uint32_t LoadUnsigned(const uint8_t* data, int width) {
+    switch (width) {
+        case 1:
+            return data[0];
+        case 2:
+            return data[0] | (uint32_t{data[1]} << 8);
+        default:
+            return data[0] | (uint32_t{data[1]} << 8) | (uint32_t{data[2]} << 16) | (uint32_t{data[3]} << 24);
+    }
+}
+
+#ifdef POSTING_CODEC_X86_DISPATCH
+
+// The vectorized decoders are compiled for their instruction sets whatever the build flags are,
+// and GetPostingDecoders offers only those the CPU supports
+
+const size_t AVX2_VECTOR_SIZE = 8;
+const size_t SSE41_VECTOR_SIZE = 4;
+
+// Loads 8 values of the given width and widens them to 32 bits
+__attribute__((target("avx2")))
+__m256i LoadWidenedAvx2(const uint8_t* data, int width) {
+    switch (width) {
+        case 1:
+            return _mm256_cvtepu8_epi32(_mm_loadl_epi64(reinterpret_cast<const __m128i*>(data)));
+        case 2:
+            return _mm256_cvtepu16_epi32(_mm_loadu_si128(reinterpret_cast<const __m128i*>(data)));
+        default:
+            return _mm256_loadu_si256(reinterpret_cast<const __m256i*>(data));
+    }
+}
+
+__attribute__((target("avx2")))
+void DecodeUnsignedAvx2(const uint8_t* data, size_t size, int width, uint32_t* values) {
+    size_t i = 0;
+    for (; i + AVX2_VECTOR_SIZE <= size; i += AVX2_VECTOR_SIZE) {
+        _mm256_storeu_si256(reinterpret_cast<__m256i*>(values + i), LoadWidenedAvx2(data + i * width, width));
+    }
+    DecodeUnsignedScalar(data + i * width, size - i, width, values + i);
+}
+
+__attribute__((target("avx2")))
+void DecodeDocumentIdsAvx2(const uint8_t* data, size_t size, int width, int base_document_id, int* document_ids) {
+    __m256i carry = _mm256_set1_epi32(base_document_id);
+    size_t i = 0;
+    for (; i + AVX2_VECTOR_SIZE <= size; i += AVX2_VECTOR_SIZE) {
+        __m256i ids = LoadWidenedAvx2(data + i * width, width);
+        // prefix sum inside each 128-bit lane, then carry the low lane total into the high lane
+        ids = _mm256_add_epi32(ids, _mm256_slli_si256(ids, 4));
+        ids = _mm256_add_epi32(ids, _mm256_slli_si256(ids, 8));
+        const __m256i lane_totals = _mm256_shuffle_epi32(ids, 0xFF);
+        ids = _mm256_add_epi32(ids, _mm256_permute2x128_si256(lane_totals, lane_totals, 0x08));
+        ids = _mm256_add_epi32(ids, carry);
+        _mm256_storeu_si256(reinterpret_cast<__m256i*>(document_ids + i), ids);
+        carry = _mm256_permutevar8x32_epi32(ids, _mm256_set1_epi32(7));
+    }
+    const int last_document_id = i == 0 ? base_document_id : document_ids[i - 1];
+    DecodeDocumentIdsScalar(data + i * width, size - i, width, last_document_id, document_ids + i);
+}
+
+// Loads 4 values of the given width and widens them to 32 bits
+__attribute__((target("sse4.1")))
+__m128i LoadWidenedSse41(const uint8_t* data, int width) {
+    switch (width) {
+        case 1: {
+            int32_t bytes;
+            std::memcpy(&bytes, data, sizeof(bytes));
+            return _mm_cvtepu8_epi32(_mm_cvtsi32_si128(bytes));
+        }
+        case 2:
+            return _mm_cvtepu16_epi32(_mm_loadl_epi64(reinterpret_cast<const __m128i*>(data)));
+        default:
+            return _mm_loadu_si128(reinterpret_cast<const __m128i*>(data));
+    }
+}
+
+__attribute__((target("sse4.1")))
+void DecodeUnsignedSse41(const uint8_t* data, size_t size, int width, uint32_t* values) {
+    size_t i = 0;
+    for (; i + SSE41_VECTOR_SIZE <= size; i += SSE41_VECTOR_SIZE) {
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(values + i), LoadWidenedSse41(data + i * width, width));
+    }
+    DecodeUnsignedScalar(data + i * width, size - i, width, values + i);
+}
+
+__attribute__((target("sse4.1")))
+void DecodeDocumentIdsSse41(const uint8_t* data, size_t size, int width, int base_document_id, int* document_ids) {
+    __m128i carry = _mm_set1_epi32(base_document_id);
+    size_t i = 0;
+    for (; i + SSE41_VECTOR_SIZE <= size; i += SSE41_VECTOR_SIZE) {
+        __m128i ids = LoadWidenedSse41(data + i * width, width);
+        ids = _mm_add_epi32(ids, _mm_slli_si128(ids, 4));
+        ids = _mm_add_epi32(ids, _mm_slli_si128(ids, 8));
+        ids = _mm_add_epi32(ids, carry);
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(document_ids + i), ids);
+        carry = _mm_shuffle_epi32(ids, 0xFF);
+    }
+    const int last_document_id = i == 0 ? base_document_id : document_ids[i - 1];
+    DecodeDocumentIdsScalar(data + i * width, size - i, width, last_document_id, document_ids + i);
+}
+
+#endif
+
+std::vector<PostingDecoder> DetectPostingDecoders() {
+    std::vector<PostingDecoder> decoders;
+#ifdef POSTING_CODEC_X86_DISPATCH
+    __builtin_cpu_init();
+    if (__builtin_cpu_supports("avx2")) {
+        decoders.push_back({"avx2", DecodeUnsignedAvx2, DecodeDocumentIdsAvx2});
+    }
+    if (__builtin_cpu_supports("sse4.1")) {
+        decoders.push_back({"sse4.1", DecodeUnsignedSse41, DecodeDocumentIdsSse41});
+    }
+#endif
+    decoders.push_back({"scalar", DecodeUnsignedScalar, DecodeDocumentIdsScalar});
+    return decoders;
+}
+
+const PostingDecoder& GetBestPostingDecoder() {
+    static const PostingDecoder decoder = GetPostingDecoders().front();
+    return decoder;
+}
+
+}
+
+int GetByteWidth(uint32_t max_value) {
+    if (max_value <= 0xFF) {
+        return 1;
+    }
+    if (max_value <= 0xFFFF) {
+        return 2;
+    }
+    return 4;
+}
+
+void EncodeUnsigned(const uint32_t* values, size_t size, int width, std::vector<uint8_t>& out) {
+    for (size_t i = 0; i < size; ++i) {
+        for (int byte = 0; byte < width; ++byte) {
+            out.push_back(static_cast<uint8_t>(values[i] >> (8 * byte)));
+        }
+    }
+}
+
+void DecodeUnsignedScalar(const uint8_t* data, size_t size, int width, uint32_t* values) {
+    for (size_t i = 0; i < size; ++i) {
+        values[i] = LoadUnsigned(data + i * width, width);
+    }
+}
+
+void DecodeDocumentIdsScalar(const uint8_t* data, size_t size, int width, int base_document_id, int* document_ids) {
+    uint32_t document_id = static_cast<uint32_t>(base_document_id);
+    for (size_t i = 0; i < size; ++i) {
+        document_id += LoadUnsigned(data + i * width, width);
+        document_ids[i] = static_cast<int>(document_id);
+    }
+}
+
+void DecodeUnsigned(const uint8_t* data, size_t size, int width, uint32_t* values) {
+    GetBestPostingDecoder().decode_unsigned(data, size, width, values);
+}
+
+void DecodeDocumentIds(const uint8_t* data, size_t size, int width, int base_document_id, int* document_ids) {
+    GetBestPostingDecoder().decode_document_ids(data, size, width, base_document_id, document_ids);
+}
+
+const std::vector<PostingDecoder>& GetPostingDecoders() {
+    static const std::vector<PostingDecoder> decoders = DetectPostingDecoders();
+    return decoders;
+}
+
+const char* GetPostingDecoderName() {
+    return GetBestPostingDecoder().name;
+}
@@ -0,0 +1,37 @@
+#pragma once
+
+#include <vector>
+#include <cstddef>
+#include <cstdint>
+
+// Blocks of posting values are stored as little-endian unsigned integers of a fixed
+// byte width (1, 2 or 4) chosen per block from the largest value in it.
+// Document ids are stored as deltas from the previous id and restored with a prefix sum.
+
+int GetByteWidth(uint32_t max_value);
+
+void EncodeUnsigned(const uint32_t* values, size_t size, int width, std::vector<uint8_t>& out);
+
+void DecodeUnsigned(const uint8_t* data, size_t size, int width, uint32_t* values);
+
+// Restores document ids from deltas, the first delta is relative to base_document_id
+void DecodeDocumentIds(const uint8_t* data, size_t size, int width, int base_document_id, int* document_ids);
+
+// Portable implementations, also used for the tails of blocks by the vectorized decoders
+void DecodeUnsignedScalar(const uint8_t* data, size_t size, int width, uint32_t* values);
+
+void DecodeDocumentIdsScalar(const uint8_t* data, size_t size, int width, int base_document_id, int* document_ids);
+
+// Block decoders of one instruction set
+struct PostingDecoder {
+    const char* name;
+    void (*decode_unsigned)(const uint8_t* data, size_t size, int width, uint32_t* values);
+    void (*decode_document_ids)(const uint8_t* data, size_t size, int width, int base_document_id, int* document_ids);
+};
+
+// Decoders the CPU supports, the fastest first and the scalar one last. The vectorized decoders are
+// picked at run time, so every build contains them; DecodeUnsigned and DecodeDocumentIds use the first
+const std::vector<PostingDecoder>& GetPostingDecoders();
+
+// Name of the instruction set used by DecodeUnsigned and DecodeDocumentIds: "avx2", "sse4.1" or "scalar"
+const char* GetPostingDecoderName();
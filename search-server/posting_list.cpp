@@ -0,0 +1,535 @@
+#include <algorithm>
+#include <cmath>
+
+#include "posting_list.h"
+#include "posting_codec.h"
+
+namespace {
+
+bool RawPostingLess(const RawPosting& lhs, const RawPosting& rhs) {
+    return lhs.document_id < rhs.document_id;
+}
+
+std::vector<RawPosting>::const_iterator LowerBound(const std::vector<RawPosting>& postings, int document_id) {
+    return std::lower_bound(postings.begin(), postings.end(), RawPosting{document_id, 0, 0}, RawPostingLess);
+}
+
+std::vector<RawPosting>::iterator LowerBound(std::vector<RawPosting>& postings, int document_id) {
+    return std::lower_bound(postings.begin(), postings.end(), RawPosting{document_id, 0, 0}, RawPostingLess);
+}
+
+}
+
+PostingList::Cursor::Cursor(const PostingList& postings)
+    : postings_(&postings)
+    , pending_current_(postings.pending_.data())
+    , pending_end_(postings.pending_.data() + postings.pending_.size()) {
+}
+
+bool PostingList::Cursor::AtEnd() const {
+    return block_position_ == block_size_ && next_block_ == postings_->block_count_
+        && pending_current_ == pending_end_;
+}
+
+int PostingList::Cursor::NextDocumentId() const {
+    int64_t document_id = INT64_MAX;
+    if (block_position_ < block_size_) {
+        document_id = block_[block_position_].document_id;
+    } else if (next_block_ < postings_->block_count_) {
+        document_id = postings_->blocks_view_[next_block_].first_document_id;
+    }
+    if (pending_current_ != pending_end_) {
+        document_id = std::min<int64_t>(document_id, pending_current_->document_id);
+    }
+    return static_cast<int>(document_id);
+}
+
+void PostingList::Cursor::SkipTo(int64_t document_id) {
+    const auto posting_less = [](const Posting& posting, int64_t id) {
+        return posting.document_id < id;
+    };
+    if (block_position_ < block_size_ && block_[block_size_ - 1].document_id >= document_id) {
+        block_position_ = std::lower_bound(block_.begin() + block_position_, block_.begin() + block_size_,
+            document_id, posting_less) - block_.begin();
+    } else {
+        block_position_ = block_size_;
+        const Block* blocks = postings_->blocks_view_;
+        const size_t block_count = postings_->block_count_;
+        next_block_ = std::lower_bound(blocks + next_block_, blocks + block_count, document_id,
+            [](const Block& block, int64_t id) {
+                return block.last_document_id < id;
+            }) - blocks;
+        if (next_block_ < block_count && blocks[next_block_].first_document_id < document_id) {
+            DecodeNextBlock();
+            block_position_ = std::lower_bound(block_.begin(), block_.begin() + block_size_,
+                document_id, posting_less) - block_.begin();
+        }
+    }
+    pending_current_ = std::lower_bound(pending_current_, pending_end_, document_id,
+        [](const RawPosting& posting, int64_t id) {
+            return posting.document_id < id;
+        });
+}
+
+void PostingList::Cursor::DecodeNextBlock() {
+    std::array<RawPosting, BLOCK_SIZE> raw_postings;
+    postings_->DecodeBlock(next_block_, raw_postings.data());
+    block_size_ = postings_->blocks_view_[next_block_].size;
+    for (size_t i = 0; i < block_size_; ++i) {
+        block_[i] = {raw_postings[i].document_id, ComputeTermFreq(raw_postings[i].term_count, raw_postings[i].word_count)};
+    }
+    block_position_ = 0;
+    ++next_block_;
+}
+
+Posting PostingList::Cursor::Next() {
+    if (block_position_ == block_size_ && next_block_ < postings_->block_count_
+        && (pending_current_ == pending_end_ || postings_->blocks_view_[next_block_].first_document_id < pending_current_->document_id)) {
+        DecodeNextBlock();
+    }
+    if (block_position_ < block_size_
+        && (pending_current_ == pending_end_ || block_[block_position_].document_id < pending_current_->document_id)) {
+        return block_[block_position_++];
+    }
+    const RawPosting& posting = *pending_current_++;
+    return {posting.document_id, ComputeTermFreq(posting.term_count, posting.word_count)};
+}
+
+double PostingList::Cursor::GetTermFreqBound(int64_t document_id) const {
+    double bound = 0.0;
+    const Block* blocks = postings_->blocks_view_;
+    const size_t block_count = postings_->block_count_;
+    // the decoded block is the one before next_block_
+    const size_t first_block = block_position_ < block_size_ ? next_block_ - 1 : next_block_;
+    const Block* block = std::lower_bound(blocks + first_block, blocks + block_count, document_id,
+        [](const Block& candidate, int64_t id) {
+            return candidate.last_document_id < id;
+        });
+    if (block != blocks + block_count && block->first_document_id <= document_id) {
+        bound = block->max_term_freq;
+    }
+    const RawPosting* pending = std::lower_bound(pending_current_, pending_end_, document_id,
+        [](const RawPosting& posting, int64_t id) {
+            return posting.document_id < id;
+        });
+    if (pending != pending_end_ && pending->document_id == document_id) {
+        bound = std::max(bound, ComputeTermFreq(pending->term_count, pending->word_count));
+    }
+    return bound;
+}
+
+PostingList::PostingList(const PostingList& other) {
+    *this = other;
+}
+
+PostingList& PostingList::operator=(const PostingList& other) {
+    blocks_ = other.blocks_;
+    data_ = other.data_;
+    is_external_ = other.is_external_;
+    if (is_external_) {
+        blocks_view_ = other.blocks_view_;
+        block_count_ = other.block_count_;
+        data_view_ = other.data_view_;
+        data_size_ = other.data_size_;
+    } else {
+        UpdateViews();
+    }
+    block_posting_count_ = other.block_posting_count_;
+    pending_ = other.pending_;
+    InvalidateCachedStats();
+    return *this;
+}
+
+PostingList::PostingList(PostingList&& other) noexcept {
+    *this = std::move(other);
+}
+
+//moving the vectors keeps their buffers, so the views of an owned list stay valid
+PostingList& PostingList::operator=(PostingList&& other) noexcept {
+    if (this == &other) {
+        return *this;
+    }
+    blocks_ = std::move(other.blocks_);
+    data_ = std::move(other.data_);
+    blocks_view_ = other.blocks_view_;
+    block_count_ = other.block_count_;
+    data_view_ = other.data_view_;
+    data_size_ = other.data_size_;
+    is_external_ = other.is_external_;
+    block_posting_count_ = other.block_posting_count_;
+    pending_ = std::move(other.pending_);
+    inverse_document_freq_.store(other.inverse_document_freq_.load(std::memory_order_relaxed), std::memory_order_relaxed);
+    idf_document_count_.store(other.idf_document_count_.load(std::memory_order_relaxed), std::memory_order_relaxed);
+    max_term_freq_.store(other.max_term_freq_.load(std::memory_order_relaxed), std::memory_order_relaxed);
+
+    other.blocks_.clear();
+    other.data_.clear();
+    other.pending_.clear();
+    other.is_external_ = false;
+    other.block_posting_count_ = 0;
+    other.UpdateViews();
+    other.InvalidateCachedStats();
+    return *this;
+}
+
+PostingList PostingList::FromEncoded(const uint8_t* blocks, size_t blocks_size, const uint8_t* data, size_t data_size,
+    size_t posting_count) {
+    PostingList postings;
+    postings.is_external_ = true;
+    postings.blocks_view_ = reinterpret_cast<const Block*>(blocks);
+    postings.block_count_ = blocks_size / sizeof(Block);
+    postings.data_view_ = data;
+    postings.data_size_ = data_size;
+    postings.block_posting_count_ = posting_count;
+    return postings;
+}
+
+bool PostingList::IsValidEncoded(const uint8_t* blocks, size_t blocks_size, const uint8_t* data, size_t data_size,
+    size_t posting_count, uint64_t document_id_end) {
+    if (blocks_size % sizeof(Block) != 0) {
+        return false;
+    }
+    const Block* block_views = reinterpret_cast<const Block*>(blocks);
+    //the widths GetByteWidth gives, the decoders read 4 bytes for any other
+    const auto is_valid_width = [](uint8_t width) {
+        return width == 1 || width == 2 || width == 4;
+    };
+    std::array<uint32_t, BLOCK_SIZE> values;
+    size_t block_posting_count = 0;
+    size_t data_end = 0;
+    int64_t last_document_id = -1;
+    for (size_t i = 0; i < blocks_size / sizeof(Block); ++i) {
+        const Block& block = block_views[i];
+        if (block.size == 0 || block.size > BLOCK_SIZE || !is_valid_width(block.delta_width)
+            || !is_valid_width(block.term_count_width) || !is_valid_width(block.word_count_width)) {
+            return false;
+        }
+        const size_t width = block.delta_width + block.term_count_width + block.word_count_width;
+        if (block.offset != data_end || block.size * width > data_size - data_end) {
+            return false;
+        }
+        if (block.first_document_id <= last_document_id || block.last_document_id < block.first_document_id
+            || static_cast<uint64_t>(block.last_document_id) >= document_id_end) {
+            return false;
+        }
+
+        //the ids are summed up in 64 bits, so a corrupt delta can't overflow into a valid looking id
+        const uint8_t* block_data = data + block.offset;
+        DecodeUnsigned(block_data, block.size, block.delta_width, values.data());
+        int64_t document_id = block.first_document_id;
+        for (size_t j = 0; j < block.size; ++j) {
+            if ((j == 0) != (values[j] == 0)) {
+                return false;
+            }
+            document_id += values[j];
+        }
+        if (document_id != block.last_document_id) {
+            return false;
+        }
+        block_data += block.size * block.delta_width;
+        for (const uint8_t count_width : {block.term_count_width, block.word_count_width}) {
+            DecodeUnsigned(block_data, block.size, count_width, values.data());
+            if (std::find(values.begin(), values.begin() + block.size, 0u) != values.begin() + block.size) {
+                return false;
+            }
+            block_data += block.size * count_width;
+        }
+
+        block_posting_count += block.size;
+        data_end += block.size * width;
+        last_document_id = block.last_document_id;
+    }
+    return data_end == data_size && block_posting_count == posting_count;
+}
+
+void PostingList::AppendEncoded(std::vector<uint8_t>& blocks, std::vector<uint8_t>& data) const {
+    PostingList compacted(*this);
+    compacted.Compact();
+    const uint8_t* block_bytes = reinterpret_cast<const uint8_t*>(compacted.blocks_view_);
+    blocks.insert(blocks.end(), block_bytes, block_bytes + compacted.block_count_ * sizeof(Block));
+    data.insert(data.end(), compacted.data_view_, compacted.data_view_ + compacted.data_size_);
+}
+
+PostingList::Cursor PostingList::GetCursor() const {
+    return Cursor(*this);
+}
+
+void PostingList::Add(int document_id, uint32_t term_count, uint32_t word_count) {
+    OwnStorage();
+    InvalidateCachedStats();
+    if (pending_.empty() || pending_.back().document_id < document_id) {
+        pending_.push_back({document_id, term_count, word_count});
+    } else {
+        pending_.insert(LowerBound(pending_, document_id), {document_id, term_count, word_count});
+    }
+    CompactIfNeeded();
+}
+
+void PostingList::Add(const std::vector<RawPosting>& postings) {
+    OwnStorage();
+    InvalidateCachedStats();
+    const size_t middle = pending_.size();
+    pending_.insert(pending_.end(), postings.begin(), postings.end());
+    std::inplace_merge(pending_.begin(), pending_.begin() + middle, pending_.end(), RawPostingLess);
+    CompactIfNeeded();
+}
+
+bool PostingList::Remove(int document_id) {
+    OwnStorage();
+    auto pending_it = LowerBound(pending_, document_id);
+    if (pending_it != pending_.end() && pending_it->document_id == document_id) {
+        pending_.erase(pending_it);
+        InvalidateCachedStats();
+        return true;
+    }
+    const size_t block_index = FindBlock(document_id);
+    if (block_index == block_count_) {
+        return false;
+    }
+    std::vector<RawPosting> postings(blocks_[block_index].size);
+    DecodeBlock(block_index, postings.data());
+    auto it = LowerBound(postings, document_id);
+    if (it == postings.end() || it->document_id != document_id) {
+        return false;
+    }
+    postings.erase(it);
+    ReplaceBlock(block_index, postings);
+    InvalidateCachedStats();
+    return true;
+}
+
+std::optional<Posting> PostingList::Find(int document_id) const {
+    auto pending_it = LowerBound(pending_, document_id);
+    if (pending_it != pending_.end() && pending_it->document_id == document_id) {
+        return Posting{document_id, ComputeTermFreq(pending_it->term_count, pending_it->word_count)};
+    }
+    const size_t block_index = FindBlock(document_id);
+    if (block_index == block_count_) {
+        return std::nullopt;
+    }
+    std::array<RawPosting, BLOCK_SIZE> postings;
+    DecodeBlock(block_index, postings.data());
+    const auto end = postings.begin() + blocks_view_[block_index].size;
+    auto it = std::lower_bound(postings.begin(), end, RawPosting{document_id, 0, 0}, RawPostingLess);
+    if (it == end || it->document_id != document_id) {
+        return std::nullopt;
+    }
+    return Posting{document_id, ComputeTermFreq(it->term_count, it->word_count)};
+}
+
+bool PostingList::Contains(int document_id) const {
+    return Find(document_id).has_value();
+}
+
+size_t PostingList::size() const {
+    return block_posting_count_ + pending_.size();
+}
+
+bool PostingList::empty() const {
+    return block_count_ == 0 && pending_.empty();
+}
+
+int PostingList::GetFirstDocumentId() const {
+    if (block_count_ == 0 || (!pending_.empty() && pending_.front().document_id < blocks_view_[0].first_document_id)) {
+        return pending_.front().document_id;
+    }
+    return blocks_view_[0].first_document_id;
+}
+
+size_t PostingList::GetByteSize() const {
+    return block_count_ * sizeof(Block) + data_size_ + pending_.size() * sizeof(RawPosting);
+}
+
+void PostingList::Compact() {
+    if (pending_.empty()) {
+        return;
+    }
+    std::vector<RawPosting> postings(block_posting_count_);
+    for (size_t i = 0, position = 0; i < block_count_; position += blocks_view_[i].size, ++i) {
+        DecodeBlock(i, postings.data() + position);
+    }
+    const size_t middle = postings.size();
+    postings.insert(postings.end(), pending_.begin(), pending_.end());
+    std::inplace_merge(postings.begin(), postings.begin() + middle, postings.end(), RawPostingLess);
+
+    std::vector<Block> blocks;
+    std::vector<uint8_t> data;
+    EncodeBlocks(postings.data(), postings.size(), blocks, data);
+    blocks_ = std::move(blocks);
+    data_ = std::move(data);
+    is_external_ = false;
+    UpdateViews();
+    block_posting_count_ = postings.size();
+    pending_.clear();
+    pending_.shrink_to_fit();
+}
+
+double PostingList::GetInverseDocumentFreq(int document_count) const {
+    if (idf_document_count_.load(std::memory_order_acquire) != document_count) {
+        inverse_document_freq_.store(ComputeInverseDocumentFreq(document_count, size()), std::memory_order_relaxed);
+        idf_document_count_.store(document_count, std::memory_order_release);
+    }
+    return inverse_document_freq_.load(std::memory_order_relaxed);
+}
+
+double PostingList::GetMaxTermFreq() const {
+    double max_term_freq = max_term_freq_.load(std::memory_order_relaxed);
+    if (max_term_freq < 0.0) {
+        max_term_freq = 0.0;
+        for (size_t i = 0; i < block_count_; ++i) {
+            max_term_freq = std::max<double>(max_term_freq, blocks_view_[i].max_term_freq);
+        }
+        for (const RawPosting& posting : pending_) {
+            max_term_freq = std::max(max_term_freq, ComputeTermFreq(posting.term_count, posting.word_count));
+        }
+        max_term_freq_.store(max_term_freq, std::memory_order_relaxed);
+    }
+    return max_term_freq;
+}
+
+// Copies blocks read from external memory into the owned vectors before a modification
+void PostingList::OwnStorage() {
+    if (!is_external_) {
+        return;
+    }
+    blocks_.assign(blocks_view_, blocks_view_ + block_count_);
+    data_.assign(data_view_, data_view_ + data_size_);
+    is_external_ = false;
+    UpdateViews();
+}
+
+void PostingList::UpdateViews() {
+    blocks_view_ = blocks_.data();
+    block_count_ = blocks_.size();
+    data_view_ = data_.data();
+    data_size_ = data_.size();
+}
+
+// Index of the block that may contain document_id or the block count if there is no such block
+size_t PostingList::FindBlock(int document_id) const {
+    const Block* it = std::lower_bound(blocks_view_, blocks_view_ + block_count_, document_id,
+        [](const Block& block, int id) {
+            return block.last_document_id < id;
+        });
+    if (it == blocks_view_ + block_count_ || it->first_document_id > document_id) {
+        return block_count_;
+    }
+    return it - blocks_view_;
+}
+
+size_t PostingList::GetBlockByteSize(size_t block_index) const {
+    const size_t end = block_index + 1 < block_count_ ? blocks_view_[block_index + 1].offset : data_size_;
+    return end - blocks_view_[block_index].offset;
+}
+
+void PostingList::DecodeBlock(size_t block_index, RawPosting* postings) const {
+    const Block& block = blocks_view_[block_index];
+    const uint8_t* data = data_view_ + block.offset;
+    std::array<int, BLOCK_SIZE> document_ids;
+    std::array<uint32_t, BLOCK_SIZE> term_counts;
+    std::array<uint32_t, BLOCK_SIZE> word_counts;
+    DecodeDocumentIds(data, block.size, block.delta_width, block.first_document_id, document_ids.data());
+    data += block.size * block.delta_width;
+    DecodeUnsigned(data, block.size, block.term_count_width, term_counts.data());
+    data += block.size * block.term_count_width;
+    DecodeUnsigned(data, block.size, block.word_count_width, word_counts.data());
+    for (size_t i = 0; i < block.size; ++i) {
+        postings[i] = {document_ids[i], term_counts[i], word_counts[i]};
+    }
+}
+
+// Appends blocks encoding the sorted postings to blocks and data
+void PostingList::EncodeBlocks(const RawPosting* postings, size_t size,
+    std::vector<Block>& blocks, std::vector<uint8_t>& data) const {
+    static_assert(sizeof(Block) == 24, "Block must have no implicit padding");
+    std::array<uint32_t, BLOCK_SIZE> values;
+    for (size_t begin = 0; begin < size; begin += BLOCK_SIZE) {
+        const size_t block_size = std::min(BLOCK_SIZE, size - begin);
+        const RawPosting* block_postings = postings + begin;
+        Block block{};
+        block.first_document_id = block_postings[0].document_id;
+        block.last_document_id = block_postings[block_size - 1].document_id;
+        block.offset = data.size();
+        block.size = block_size;
+        for (size_t i = 0; i < block_size; ++i) {
+            const double term_freq = ComputeTermFreq(block_postings[i].term_count, block_postings[i].word_count);
+            float max_term_freq = static_cast<float>(term_freq);
+            if (max_term_freq < term_freq) {
+                max_term_freq = std::nextafter(max_term_freq, INFINITY);
+            }
+            block.max_term_freq = std::max(block.max_term_freq, max_term_freq);
+        }
+
+        values[0] = 0;
+        for (size_t i = 1; i < block_size; ++i) {
+            values[i] = block_postings[i].document_id - block_postings[i - 1].document_id;
+        }
+        block.delta_width = GetByteWidth(*std::max_element(values.begin(), values.begin() + block_size));
+        EncodeUnsigned(values.data(), block_size, block.delta_width, data);
+
+        for (size_t i = 0; i < block_size; ++i) {
+            values[i] = block_postings[i].term_count;
+        }
+        block.term_count_width = GetByteWidth(*std::max_element(values.begin(), values.begin() + block_size));
+        EncodeUnsigned(values.data(), block_size, block.term_count_width, data);
+
+        for (size_t i = 0; i < block_size; ++i) {
+            values[i] = block_postings[i].word_count;
+        }
+        block.word_count_width = GetByteWidth(*std::max_element(values.begin(), values.begin() + block_size));
+        EncodeUnsigned(values.data(), block_size, block.word_count_width, data);
+
+        blocks.push_back(block);
+    }
+}
+
+// Re-encodes a single block in place, shifting the data of the following blocks
+void PostingList::ReplaceBlock(size_t block_index, const std::vector<RawPosting>& postings) {
+    std::vector<Block> blocks;
+    std::vector<uint8_t> data;
+    EncodeBlocks(postings.data(), postings.size(), blocks, data);
+
+    const size_t offset = blocks_[block_index].offset;
+    const size_t old_byte_size = GetBlockByteSize(block_index);
+    block_posting_count_ = block_posting_count_ - blocks_[block_index].size + postings.size();
+    data_.erase(data_.begin() + offset, data_.begin() + offset + old_byte_size);
+    data_.insert(data_.begin() + offset, data.begin(), data.end());
+    for (size_t i = block_index + 1; i < blocks_.size(); ++i) {
+        blocks_[i].offset = blocks_[i].offset - old_byte_size + data.size();
+    }
+    for (Block& block : blocks) {
+        block.offset += offset;
+    }
+    blocks_.erase(blocks_.begin() + block_index);
+    blocks_.insert(blocks_.begin() + block_index, blocks.begin(), blocks.end());
+    UpdateViews();
+}
+
+// Moves full blocks from the front of the append buffer to the compressed part.
+// All buffered ids must be greater than the compressed ones
+void PostingList::FlushPendingBlocks() {
+    const size_t flushed = pending_.size() / BLOCK_SIZE * BLOCK_SIZE;
+    EncodeBlocks(pending_.data(), flushed, blocks_, data_);
+    UpdateViews();
+    block_posting_count_ += flushed;
+    pending_.erase(pending_.begin(), pending_.begin() + flushed);
+}
+
+bool PostingList::NeedsCompaction() const {
+    const size_t limit = std::max(BLOCK_SIZE, static_cast<size_t>(std::sqrt(block_posting_count_)));
+    return pending_.size() > limit;
+}
+
+void PostingList::CompactIfNeeded() {
+    if (pending_.size() >= BLOCK_SIZE
+        && (blocks_.empty() || blocks_.back().last_document_id < pending_.front().document_id)) {
+        FlushPendingBlocks();
+    } else if (NeedsCompaction()) {
+        Compact();
+    }
+}
+
+void PostingList::InvalidateCachedStats() {
+    idf_document_count_.store(-1, std::memory_order_relaxed);
+    max_term_freq_.store(-1.0, std::memory_order_relaxed);
+}
@@ -0,0 +1,215 @@
+#pragma once
+
+#include <vector>
+#include <array>
+#include <optional>
+#include <cstddef>
+#include <cstdint>
+#include <atomic>
+#include <cmath>
+
+struct Posting {
+    int document_id;
+    double term_freq;
+};
+
+// Posting in the form it is stored: the term frequency is kept as the number of
+// occurrences of the term and the number of words in the document
+struct RawPosting {
+    int document_id;
+    uint32_t term_count;
+    uint32_t word_count;
+};
+
+inline double ComputeTermFreq(uint32_t term_count, uint32_t word_count) {
+    return term_count * (1.0 / word_count);
+}
+
+inline double ComputeInverseDocumentFreq(int document_count, size_t document_freq) {
+    return std::log(document_count * 1.0 / document_freq);
+}
+
+// Postings of a single term sorted by document id. The bulk of the list is compressed
+// into blocks of up to BLOCK_SIZE postings (see posting_codec.h), recent and out of order
+// postings are kept uncompressed in a small sorted append buffer. The buffer is flushed
+// into a new block once it holds a full block of ids past the compressed ones, or merged
+// with the whole list once it grows past ~sqrt(size()).
+class PostingList {
+public:
+    static constexpr size_t BLOCK_SIZE = 128;
+
+    // Forward-only reader over the postings in document id order of the compressed blocks
+    // and of the append buffer, each block is decoded only when the cursor reaches it
+    class Cursor {
+    public:
+        bool AtEnd() const;
+
+        // Smallest document id not yet consumed, the cursor must not be at end
+        int NextDocumentId() const;
+
+        // Skips postings with document ids less than document_id
+        void SkipTo(int64_t document_id);
+
+        // Consumes postings with document ids less than document_id
+        template <typename Func>
+        void ForEachBefore(int64_t document_id, Func func);
+
+        // Consumes the posting with the smallest document id, the cursor must not be at end
+        Posting Next();
+
+        // Upper bound of the term frequency of document_id, a document not yet consumed. Only block
+        // headers are read, so it is much cheaper than skipping to the document
+        double GetTermFreqBound(int64_t document_id) const;
+
+    private:
+        friend class PostingList;
+
+        explicit Cursor(const PostingList& postings);
+
+        void DecodeNextBlock();
+
+        const PostingList* postings_;
+        size_t next_block_ = 0;
+        size_t block_position_ = 0;
+        size_t block_size_ = 0;
+        std::array<Posting, BLOCK_SIZE> block_;
+        const RawPosting* pending_current_;
+        const RawPosting* pending_end_;
+    };
+
+    PostingList() = default;
+    PostingList(const PostingList& other);
+    PostingList& operator=(const PostingList& other);
+    // The moved list keeps the cached statistics, the source is left empty
+    PostingList(PostingList&& other) noexcept;
+    PostingList& operator=(PostingList&& other) noexcept;
+
+    // List reading compressed blocks written by AppendEncoded from external memory, e.g. a mapped
+    // snapshot file. The memory must outlive the list, it is copied on the first modification
+    static PostingList FromEncoded(const uint8_t* blocks, size_t blocks_size, const uint8_t* data, size_t data_size,
+        size_t posting_count);
+
+    // Checks the compressed blocks of an untrusted source before FromEncoded reads them: every block
+    // must lie inside the data, the blocks must follow each other, the decoded document ids must be
+    // strictly increasing, match the block headers and be less than document_id_end, and no term
+    // or word count may be 0. Every block is decoded once
+    static bool IsValidEncoded(const uint8_t* blocks, size_t blocks_size, const uint8_t* data, size_t data_size,
+        size_t posting_count, uint64_t document_id_end);
+
+    // Appends the compressed form of the whole list to blocks and data
+    void AppendEncoded(std::vector<uint8_t>& blocks, std::vector<uint8_t>& data) const;
+
+    Cursor GetCursor() const;
+
+    void Add(int document_id, uint32_t term_count, uint32_t word_count);
+
+    // Adds postings sorted by document id, none of the documents may be in the list already
+    void Add(const std::vector<RawPosting>& postings);
+
+    bool Remove(int document_id);
+
+    std::optional<Posting> Find(int document_id) const;
+
+    bool Contains(int document_id) const;
+
+    size_t size() const;
+
+    bool empty() const;
+
+    int GetFirstDocumentId() const;
+
+    // Bytes used by the postings, including block headers and the append buffer
+    size_t GetByteSize() const;
+
+    // Compresses the append buffer into blocks
+    void Compact();
+
+    // IDF of the term in a collection of document_count documents. The value is computed once
+    // and reused until the document count or the list itself changes; safe to call from concurrent readers
+    double GetInverseDocumentFreq(int document_count) const;
+
+    // Upper bound of the term frequencies in the list, cached like the IDF
+    double GetMaxTermFreq() const;
+
+    template <typename Func>
+    void ForEach(Func func) const;
+
+private:
+    struct Block {
+        int first_document_id;
+        int last_document_id;
+        uint32_t offset;
+        // not less than any term frequency in the block
+        float max_term_freq;
+        uint16_t size;
+        uint8_t delta_width;
+        uint8_t term_count_width;
+        uint8_t word_count_width;
+        // blocks are written to snapshots byte for byte, so there is no padding left uninitialized
+        uint8_t reserved[3];
+    };
+
+    // blocks and data are read through the views which point either to
+    // the owned vectors or to external memory the list was created over
+    std::vector<Block> blocks_;
+    std::vector<uint8_t> data_;
+    const Block* blocks_view_ = nullptr;
+    size_t block_count_ = 0;
+    const uint8_t* data_view_ = nullptr;
+    size_t data_size_ = 0;
+    bool is_external_ = false;
+    size_t block_posting_count_ = 0;
+    std::vector<RawPosting> pending_;
+    mutable std::atomic<double> inverse_document_freq_{0.0};
+    mutable std::atomic<int> idf_document_count_{-1};
+    mutable std::atomic<double> max_term_freq_{-1.0};
+
+    void OwnStorage();
+
+    void UpdateViews();
+
+    size_t FindBlock(int document_id) const;
+
+    size_t GetBlockByteSize(size_t block_index) const;
+
+    void DecodeBlock(size_t block_index, RawPosting* postings) const;
+
+    void EncodeBlocks(const RawPosting* postings, size_t size, std::vector<Block>& blocks, std::vector<uint8_t>& data) const;
+
+    void ReplaceBlock(size_t block_index, const std::vector<RawPosting>& postings);
+
+    void FlushPendingBlocks();
+
+    bool NeedsCompaction() const;
+
+    void CompactIfNeeded();
+
+    void InvalidateCachedStats();
+};
+
+template <typename Func>
+void PostingList::Cursor::ForEachBefore(int64_t document_id, Func func) {
+    const Block* blocks = postings_->blocks_view_;
+    while (true) {
+        for (; block_position_ < block_size_; ++block_position_) {
+            if (block_[block_position_].document_id >= document_id) {
+                break;
+            }
+            func(block_[block_position_]);
+        }
+        if (block_position_ < block_size_ || next_block_ == postings_->block_count_
+            || blocks[next_block_].first_document_id >= document_id) {
+            break;
+        }
+        DecodeNextBlock();
+    }
+    for (; pending_current_ != pending_end_ && pending_current_->document_id < document_id; ++pending_current_) {
+        func(Posting{pending_current_->document_id, ComputeTermFreq(pending_current_->term_count, pending_current_->word_count)});
+    }
+}
+
+template <typename Func>
+void PostingList::ForEach(Func func) const {
+    Cursor cursor = GetCursor();
+    cursor.ForEachBefore(INT64_MAX, func);
+}
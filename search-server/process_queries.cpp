@@ -1,28 +1,166 @@
 #include <algorithm>
-#include <execution>
+#include <stdexcept>
 
 #include "process_queries.h"
 
+using namespace std::string_literals;
+
+namespace {
+
+std::vector<std::vector<Document>> FindTopDocumentsOfQueries(
+    const ThreadPoolPolicy& policy,
+    const SearchServer& search_server,
+    const std::vector<std::string>& queries,
+    size_t first,
+    size_t last) {
+    std::vector<std::vector<Document>> result(last - first);
+    ParallelFor(policy, last - first, [&](size_t i) {
+        result[i] = search_server.FindTopDocuments(policy, queries[first + i]);
+    });
+    return result;
+}
+
+std::vector<Document> JoinResults(std::vector<std::vector<Document>> mid_result) {
+    size_t size = 0;
+    for (const auto& v : mid_result) {
+        size += v.size();
+    }
+    std::vector<Document> result;
+    result.reserve(size);
+    for (auto& v : mid_result) {
+        std::move(v.begin(), v.end(), std::back_inserter(result));
+        std::vector<Document>().swap(v);
+    }
+    return result;
+}
+
+} // namespace
+
+std::vector<std::vector<Document>> ProcessQueries(
+    const ThreadPoolPolicy& policy,
+    const SearchServer& search_server,
+    const std::vector<std::string>& queries) {
+        return FindTopDocumentsOfQueries(policy, search_server, queries, 0, queries.size());
+    }
+
 std::vector<std::vector<Document>> ProcessQueries(
     const SearchServer& search_server,
     const std::vector<std::string>& queries) {
-        std::vector<std::vector<Document>> result(queries.size());
-        std::transform(std::execution::par, queries.begin(), queries.end(), result.begin(), [&search_server](const auto& query) {
-            return search_server.FindTopDocuments(std::execution::par, query);
-        });
-        return result;
+        return ProcessQueries(ThreadPoolPolicy(ThreadPool::GetDefault()), search_server, queries);
     }
 
 std::vector<Document> ProcessQueriesJoined(
     const SearchServer& search_server,
     const std::vector<std::string>& queries) {
-        std::vector<Document> result(MAX_RESULT_DOCUMENT_COUNT * queries.size());
-        auto mid_result = ProcessQueries(search_server, queries);
-        int i = 0;
-        for (auto& v : mid_result) {
-            std::move(v.begin(), v.end(), result.begin() + i);
-            i += v.size();
+        return JoinResults(ProcessQueries(search_server, queries));
+    }
+
+std::vector<std::vector<Document>> ProcessQueriesBatched(
+    const SearchServer& search_server,
+    const std::vector<std::string>& queries) {
+        return search_server.FindTopDocumentsBatch(ThreadPoolPolicy(ThreadPool::GetDefault()), queries);
+    }
+
+std::vector<Document> ProcessQueriesBatchedJoined(
+    const SearchServer& search_server,
+    const std::vector<std::string>& queries) {
+        return JoinResults(ProcessQueriesBatched(search_server, queries));
+    }
+
+JoinedQueryResults::Iterator::Iterator(JoinedQueryResults* results)
+    : results_(results) {
+}
+
+const Document& JoinedQueryResults::Iterator::operator*() const {
+    return results_->chunk_[results_->position_];
+}
+
+const Document* JoinedQueryResults::Iterator::operator->() const {
+    return &results_->chunk_[results_->position_];
+}
+
+JoinedQueryResults::Iterator& JoinedQueryResults::Iterator::operator++() {
+    if (++results_->position_ == results_->chunk_.size() && !results_->LoadChunk()) {
+        results_ = nullptr;
+    }
+    return *this;
+}
+
+JoinedQueryResults::Iterator::PostIncrementProxy JoinedQueryResults::Iterator::operator++(int) {
+    PostIncrementProxy proxy(**this);
+    ++*this;
+    return proxy;
+}
+
+JoinedQueryResults::Iterator::PostIncrementProxy::PostIncrementProxy(const Document& document)
+    : document_(document) {
+}
+
+const Document& JoinedQueryResults::Iterator::PostIncrementProxy::operator*() const {
+    return document_;
+}
+
+bool JoinedQueryResults::Iterator::operator==(const Iterator& other) const {
+    return results_ == other.results_;
+}
+
+bool JoinedQueryResults::Iterator::operator!=(const Iterator& other) const {
+    return !(*this == other);
+}
+
+JoinedQueryResults::JoinedQueryResults(const ThreadPoolPolicy& policy, const SearchServer& search_server,
+    const std::vector<std::string>& queries, size_t chunk_size)
+    : policy_(policy)
+    , search_server_(&search_server)
+    , queries_(&queries)
+    , chunk_size_(chunk_size) {
+    if (chunk_size == 0) {
+        throw std::invalid_argument("Chunk size must be positive"s);
+    }
+}
+
+//the first call starts scoring, later calls continue from the current document
+JoinedQueryResults::Iterator JoinedQueryResults::begin() {
+    if (!is_started_) {
+        is_started_ = true;
+        StartNextChunk();
+        LoadChunk();
+    }
+    return Iterator(position_ < chunk_.size() ? this : nullptr);
+}
+
+JoinedQueryResults::Iterator JoinedQueryResults::end() {
+    return Iterator(nullptr);
+}
+
+void JoinedQueryResults::StartNextChunk() {
+    if (next_chunk_begin_ == queries_->size()) {
+        next_chunk_ = {};
+        return;
+    }
+    const size_t first = next_chunk_begin_;
+    const size_t last = std::min(first + chunk_size_, queries_->size());
+    next_chunk_begin_ = last;
+    next_chunk_ = std::async(std::launch::async, [policy = policy_, search_server = search_server_, queries = queries_, first, last] {
+        return JoinResults(FindTopDocumentsOfQueries(policy, *search_server, *queries, first, last));
+    });
+}
+
+bool JoinedQueryResults::LoadChunk() {
+    while (next_chunk_.valid()) {
+        chunk_ = next_chunk_.get();
+        position_ = 0;
+        StartNextChunk();
+        if (!chunk_.empty()) {
+            return true;
         }
-        result.resize(i);
-        return result;
+    }
+    chunk_.clear();
+    return false;
+}
+
+JoinedQueryResults ProcessQueriesJoinedLazy(
+    const SearchServer& search_server,
+    const std::vector<std::string>& queries) {
+        return JoinedQueryResults(ThreadPoolPolicy(ThreadPool::GetDefault()), search_server, queries, JOINED_QUERIES_CHUNK_SIZE);
     }
\ No newline at end of file
@@ -1,14 +1,126 @@
 #pragma once
 
 #include <vector>
+#include <string>
+#include <future>
+#include <iterator>
+#include <cstddef>
 
 #include "document.h"
 #include "search_server.h"
+#include "thread_pool.h"
 
+//queries and the scoring of every query share the pool of the policy
+std::vector<std::vector<Document>> ProcessQueries(
+    const ThreadPoolPolicy& policy,
+    const SearchServer& search_server,
+    const std::vector<std::string>& queries);
+
+//runs on ThreadPool::GetDefault()
 std::vector<std::vector<Document>> ProcessQueries(
     const SearchServer& search_server,
     const std::vector<std::string>& queries);
 
 std::vector<Document> ProcessQueriesJoined(
     const SearchServer& search_server,
-    const std::vector<std::string>& queries); 
\ No newline at end of file
+    const std::vector<std::string>& queries);
+
+//same results as ProcessQueries, but the queries are scored together with
+//SearchServer::FindTopDocumentsBatch, which decodes the postings of shared words once
+std::vector<std::vector<Document>> ProcessQueriesBatched(
+    const SearchServer& search_server,
+    const std::vector<std::string>& queries);
+
+std::vector<Document> ProcessQueriesBatchedJoined(
+    const SearchServer& search_server,
+    const std::vector<std::string>& queries);
+
+//queries scored at a time by the range of ProcessQueriesJoinedLazy
+static constexpr size_t JOINED_QUERIES_CHUNK_SIZE = 1024;
+
+//single pass range of the joined results of the queries, in query order. Queries are scored on the pool
+//chunk by chunk, the next chunk while the current one is read, so at most two chunks of results are kept
+//and the first documents are available as soon as the first chunk is done. An exception of a query is
+//thrown when the iterator reaches its chunk. The range keeps pointers to search_server and queries,
+//which must outlive it, so temporaries are not accepted
+class JoinedQueryResults {
+public:
+    class Iterator {
+    public:
+        using iterator_category = std::input_iterator_tag;
+        using value_type = Document;
+        using difference_type = std::ptrdiff_t;
+        using pointer = const Document*;
+        using reference = const Document&;
+
+        //holds a copy of the document the iterator pointed to, as *it++ needs
+        class PostIncrementProxy {
+        public:
+            const Document& operator*() const;
+
+        private:
+            friend class Iterator;
+
+            explicit PostIncrementProxy(const Document& document);
+
+            Document document_;
+        };
+
+        reference operator*() const;
+        pointer operator->() const;
+        Iterator& operator++();
+        PostIncrementProxy operator++(int);
+        bool operator==(const Iterator& other) const;
+        bool operator!=(const Iterator& other) const;
+
+    private:
+        friend class JoinedQueryResults;
+
+        explicit Iterator(JoinedQueryResults* results);
+
+        //nullptr for the end
+        JoinedQueryResults* results_;
+    };
+
+    JoinedQueryResults(const ThreadPoolPolicy& policy, const SearchServer& search_server,
+        const std::vector<std::string>& queries, size_t chunk_size);
+    JoinedQueryResults(const ThreadPoolPolicy& policy, const SearchServer& search_server,
+        std::vector<std::string>&& queries, size_t chunk_size) = delete;
+    JoinedQueryResults(const ThreadPoolPolicy& policy, SearchServer&& search_server,
+        const std::vector<std::string>& queries, size_t chunk_size) = delete;
+
+    //the first call starts scoring, later calls return an iterator to the current document;
+    //the range can't be moved once it is iterated
+    Iterator begin();
+
+    Iterator end();
+
+private:
+    ThreadPoolPolicy policy_;
+    const SearchServer* search_server_;
+    const std::vector<std::string>* queries_;
+    size_t chunk_size_;
+    size_t next_chunk_begin_ = 0;
+    std::future<std::vector<Document>> next_chunk_;
+    std::vector<Document> chunk_;
+    size_t position_ = 0;
+    bool is_started_ = false;
+
+    void StartNextChunk();
+
+    //returns false if there are no documents left
+    bool LoadChunk();
+};
+
+//runs on ThreadPool::GetDefault()
+JoinedQueryResults ProcessQueriesJoinedLazy(
+    const SearchServer& search_server,
+    const std::vector<std::string>& queries);
+
+JoinedQueryResults ProcessQueriesJoinedLazy(
+    const SearchServer& search_server,
+    std::vector<std::string>&& queries) = delete;
+
+JoinedQueryResults ProcessQueriesJoinedLazy(
+    SearchServer&& search_server,
+    const std::vector<std::string>& queries) = delete;
\ No newline at end of file
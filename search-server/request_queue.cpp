@@ -1,28 +1,72 @@
 #include "request_queue.h"
 
 
-RequestQueue::RequestQueue(const SearchServer& search_server){
+RequestQueue::RequestQueue(const SearchServer& search_server, size_t cache_capacity)
+    : cache_capacity_(cache_capacity) {
     server_ = &search_server;
     empty_requests_ = 0;
     time_ = 0;
+    cache_generation_ = server_->GetGeneration();
 }
 
 std::vector<Document> RequestQueue::AddFindRequest(std::string_view raw_query, DocumentStatus status) {
-    std::vector<Document> search_result = server_->FindTopDocuments(raw_query, status);
+    std::optional<CacheKey> key;
+    if (cache_capacity_ > 0) {
+        key = CacheKey{server_->GetNormalizedQuery(raw_query), typeid(DocumentStatus), static_cast<int>(status)};
+    }
+    std::vector<Document> search_result = FindCached(std::move(key), [&]() {
+        return server_->FindTopDocuments(raw_query, status);
+    });
     ProcessRequest(search_result);
     return search_result;
 }
 
 std::vector<Document> RequestQueue::AddFindRequest(std::string_view raw_query) {
-    std::vector<Document> search_result = server_->FindTopDocuments(raw_query);
-    ProcessRequest(search_result);
-    return search_result;
+    return AddFindRequest(raw_query, DocumentStatus::ACTUAL);
 }
 
 int RequestQueue::GetNoResultRequests() const {
     return empty_requests_;
 }
 
+QueryCacheStats RequestQueue::GetCacheStats() const {
+    return cache_stats_;
+}
+
+bool RequestQueue::CacheKey::operator==(const CacheKey& other) const {
+    return query == other.query && filter_type == other.filter_type && status == other.status;
+}
+
+size_t RequestQueue::CacheKeyHasher::operator()(const CacheKey& key) const {
+    return std::hash<std::string>{}(key.query) ^ (key.filter_type.hash_code() * 31) ^ (static_cast<size_t>(key.status) * 961);
+}
+
+// The whole cache is dropped once the server changes
+const std::vector<Document>* RequestQueue::FindInCache(const CacheKey& key) {
+    if (cache_generation_ != server_->GetGeneration()) {
+        cache_entries_.clear();
+        cache_index_.clear();
+        cache_generation_ = server_->GetGeneration();
+    }
+    const auto it = cache_index_.find(key);
+    if (it == cache_index_.end()) {
+        ++cache_stats_.misses;
+        return nullptr;
+    }
+    ++cache_stats_.hits;
+    cache_entries_.splice(cache_entries_.begin(), cache_entries_, it->second);
+    return &it->second->second;
+}
+
+void RequestQueue::AddToCache(CacheKey key, const std::vector<Document>& documents) {
+    if (cache_entries_.size() == cache_capacity_) {
+        cache_index_.erase(cache_entries_.back().first);
+        cache_entries_.pop_back();
+    }
+    cache_entries_.emplace_front(std::move(key), documents);
+    cache_index_.emplace(cache_entries_.front().first, cache_entries_.begin());
+}
+
 void RequestQueue::ProcessRequest(const std::vector<Document>& search_result) {
     QueryResult result = {search_result, search_result.empty()};
     ++time_;
@@ -4,13 +4,26 @@
 #include <deque>
 #include <string>
 #include <execution>
+#include <list>
+#include <unordered_map>
+#include <typeindex>
+#include <type_traits>
+#include <optional>
 
 #include "search_server.h"
 
 
+struct QueryCacheStats {
+    uint64_t hits = 0;
+    uint64_t misses = 0;
+};
+
 class RequestQueue {
 public:
-    explicit RequestQueue(const SearchServer& search_server);
+    //cache_capacity is the number of query results kept in the LRU result cache, 0 disables the cache.
+    //Results are keyed by the normalized query and the status or the type of a stateless predicate;
+    //requests with predicates that have state are never cached
+    explicit RequestQueue(const SearchServer& search_server, size_t cache_capacity = 0);
 
     template <typename DocumentPredicate>
     std::vector<Document> AddFindRequest(std::string_view raw_query, DocumentPredicate document_predicate);
@@ -21,6 +34,9 @@ public:
 
     int GetNoResultRequests() const;
 
+    //only requests that can be cached are counted
+    QueryCacheStats GetCacheStats() const;
+
 private:
     struct QueryResult {
         std::vector<Document> documents;
@@ -32,6 +48,33 @@ private:
     const static int min_in_day_ = 1440;
     const SearchServer* server_;
 
+    struct CacheKey {
+        std::string query;
+        std::type_index filter_type;
+        int status;
+
+        bool operator==(const CacheKey& other) const;
+    };
+
+    struct CacheKeyHasher {
+        size_t operator()(const CacheKey& key) const;
+    };
+
+    using CacheEntries = std::list<std::pair<CacheKey, std::vector<Document>>>;
+
+    size_t cache_capacity_;
+    CacheEntries cache_entries_; // most recently used first
+    std::unordered_map<CacheKey, CacheEntries::iterator, CacheKeyHasher> cache_index_;
+    uint64_t cache_generation_ = 0;
+    QueryCacheStats cache_stats_;
+
+    template <typename Search>
+    std::vector<Document> FindCached(std::optional<CacheKey> key, Search search);
+
+    const std::vector<Document>* FindInCache(const CacheKey& key);
+
+    void AddToCache(CacheKey key, const std::vector<Document>& documents);
+
     void ProcessRequest(const std::vector<Document>& search_result);
 
     void RemoveRequest();
@@ -42,7 +85,28 @@ private:
 
 template <typename DocumentPredicate>
 std::vector<Document> RequestQueue::AddFindRequest(std::string_view raw_query, DocumentPredicate document_predicate) {
-    std::vector<Document> search_result = server_->FindTopDocuments(raw_query, document_predicate);
+    std::optional<CacheKey> key;
+    if constexpr (std::is_empty_v<DocumentPredicate>) {
+        if (cache_capacity_ > 0) {
+            key = CacheKey{server_->GetNormalizedQuery(raw_query), typeid(DocumentPredicate), -1};
+        }
+    }
+    std::vector<Document> search_result = FindCached(std::move(key), [&]() {
+        return server_->FindTopDocuments(raw_query, document_predicate);
+    });
     RequestQueue::ProcessRequest(search_result);
     return search_result;
+}
+
+template <typename Search>
+std::vector<Document> RequestQueue::FindCached(std::optional<CacheKey> key, Search search) {
+    if (!key) {
+        return search();
+    }
+    if (const std::vector<Document>* documents = FindInCache(*key)) {
+        return *documents;
+    }
+    std::vector<Document> documents = search();
+    AddToCache(std::move(*key), documents);
+    return documents;
 }
\ No newline at end of file
@@ -8,6 +8,10 @@
 #include <execution>
 #include <chrono>
 #include <thread>
+#include <fstream>
+#include <cstring>
+#include <cstdio>
+#include <climits>
 
 #include "log_duration.h"
 #include "search_server.h"
@@ -17,56 +21,533 @@ using namespace std::string_literals;
 
 SearchServer::SearchServer() {}
 
+//documents_ points into the texts of other until CompactTexts copies them
+SearchServer::SearchServer(const SearchServer& other)
+    : stop_words_(other.stop_words_)
+    , terms_(other.terms_)
+    , term_postings_(other.term_postings_)
+    , document_ids_(other.document_ids_)
+    , document_ordinals_(other.document_ordinals_)
+    , free_ordinals_(other.free_ordinals_)
+    , ordinal_document_ids_(other.ordinal_document_ids_)
+    , document_ratings_(other.document_ratings_)
+    , document_statuses_(other.document_statuses_)
+    , documents_(other.documents_)
+    , status_documents_(other.status_documents_)
+    , snapshot_(other.snapshot_)
+    , generation_(other.generation_) {
+    CompactTexts();
+}
+
+SearchServer& SearchServer::operator=(const SearchServer& other) {
+    if (this != &other) {
+        *this = SearchServer(other);
+    }
+    return *this;
+}
+
 SearchServer::SearchServer(const std::string& text) {
-    for (std::string_view word : SplitIntoWords(text)) {
-        if (SearchServer::StringHasSpecialSymbols(word)) {
-            throw std::invalid_argument("There is a special symbol in stopword: "s + std::string(word));
+    const WordSplitter words(text);
+    for (auto it = words.begin(); it != words.end(); ++it) {
+        if (it.HasSpecialSymbols()) {
+            throw std::invalid_argument("There is a special symbol in stopword: "s + std::string(*it));
         }
-        stop_words_.insert(std::string(word));
     }
+    stop_words_ = StopWordSet(words);
 }
 
 SearchServer::SearchServer(std::string_view text) {
-    for (std::string_view word : SplitIntoWords(text)) {
-        if (SearchServer::StringHasSpecialSymbols(word)) {
-            throw std::invalid_argument("There is a special symbol in stopword: "s + std::string(word));
+    const WordSplitter words(text);
+    for (auto it = words.begin(); it != words.end(); ++it) {
+        if (it.HasSpecialSymbols()) {
+            throw std::invalid_argument("There is a special symbol in stopword: "s + std::string(*it));
+        }
+    }
+    stop_words_ = StopWordSet(words);
+}
+
+//a server may be copied while its readers build the term_freqs of snapshot documents,
+//so term_freqs is copied only once it is built, otherwise the copy builds its own
+SearchServer::DocumentData::DocumentData(const DocumentData& other) {
+    *this = other;
+}
+
+SearchServer::DocumentData::DocumentData(DocumentData&& other) noexcept
+    : term_freqs(std::move(other.term_freqs))
+    , text(other.text)
+    , is_from_snapshot(other.is_from_snapshot)
+    , snapshot_words(other.snapshot_words.load())
+    , snapshot_word_count(other.snapshot_word_count) {
+}
+
+SearchServer::DocumentData& SearchServer::DocumentData::operator=(const DocumentData& other) {
+    const SnapshotWord* other_snapshot_words = other.snapshot_words.load(std::memory_order_acquire);
+    if (other_snapshot_words == nullptr) {
+        term_freqs = other.term_freqs;
+    } else {
+        term_freqs.clear();
+    }
+    text = other.text;
+    is_from_snapshot = other.is_from_snapshot;
+    snapshot_words = other_snapshot_words;
+    snapshot_word_count = other.snapshot_word_count;
+    return *this;
+}
+
+SearchServer::DocumentData& SearchServer::DocumentData::operator=(DocumentData&& other) noexcept {
+    term_freqs = std::move(other.term_freqs);
+    text = other.text;
+    is_from_snapshot = other.is_from_snapshot;
+    snapshot_words = other.snapshot_words.load();
+    snapshot_word_count = other.snapshot_word_count;
+    return *this;
+}
+
+SearchServer::LoadedSnapshot::LoadedSnapshot(const std::string& path)
+    : file(path) {
+}
+
+namespace {
+
+void CheckSnapshotRange(const SnapshotHeader& header, uint64_t offset, uint64_t size) {
+    if (offset > header.file_size || size > header.file_size - offset) {
+        throw std::runtime_error("Snapshot file is corrupted"s);
+    }
+}
+
+template <typename T>
+const T* GetSnapshotSection(const uint8_t* data, const SnapshotHeader& header, uint64_t offset, uint64_t count) {
+    if (offset % alignof(T) != 0 || count > header.file_size / sizeof(T)) {
+        throw std::runtime_error("Snapshot file is corrupted"s);
+    }
+    CheckSnapshotRange(header, offset, count * sizeof(T));
+    return reinterpret_cast<const T*>(data + offset);
+}
+
+}
+
+//builds the small tables in one linear pass over the snapshot, postings and texts stay in the mapped file.
+//Every posting block is decoded once to validate it, so a corrupt file is rejected instead of read out of bounds
+SearchServer::SearchServer(std::shared_ptr<LoadedSnapshot> snapshot)
+    : snapshot_(std::move(snapshot)) {
+    const uint8_t* data = snapshot_->file.data();
+    SnapshotHeader header;
+    if (snapshot_->file.size() < sizeof(header)) {
+        throw std::runtime_error("Snapshot file is too short"s);
+    }
+    std::memcpy(&header, data, sizeof(header));
+    if (std::memcmp(header.magic, SNAPSHOT_MAGIC, sizeof(header.magic)) != 0) {
+        throw std::runtime_error("File is not a search server snapshot"s);
+    }
+    if (header.byte_order_mark != SNAPSHOT_BYTE_ORDER_MARK) {
+        throw std::runtime_error("Snapshot was written on a machine with another byte order"s);
+    }
+    if (header.version != SNAPSHOT_VERSION) {
+        throw std::runtime_error("Unsupported snapshot version: "s + std::to_string(header.version));
+    }
+    if (header.file_size != snapshot_->file.size()) {
+        throw std::runtime_error("Snapshot file is corrupted"s);
+    }
+
+    const auto* stop_words = GetSnapshotSection<SnapshotString>(data, header, header.stop_words_offset, header.stop_word_count);
+    const auto* terms = GetSnapshotSection<SnapshotTerm>(data, header, header.terms_offset, header.term_count);
+    const auto* documents = GetSnapshotSection<SnapshotDocument>(data, header, header.documents_offset, header.document_count);
+    CheckSnapshotRange(header, header.words_offset, 0);
+    CheckSnapshotRange(header, header.blocks_offset, 0);
+    CheckSnapshotRange(header, header.postings_offset, 0);
+    CheckSnapshotRange(header, header.strings_offset, 0);
+    const char* strings = reinterpret_cast<const char*>(data + header.strings_offset);
+    const uint64_t strings_size = header.file_size - header.strings_offset;
+    const auto get_string = [&](const SnapshotString& string) {
+        if (string.offset > strings_size || string.size > strings_size - string.offset) {
+            throw std::runtime_error("Snapshot file is corrupted"s);
+        }
+        return std::string_view(strings + string.offset, string.size);
+    };
+    if (header.document_count > header.ordinal_count || header.ordinal_count > static_cast<uint64_t>(INT_MAX)) {
+        throw std::runtime_error("Snapshot file is corrupted"s);
+    }
+    snapshot_->term_count = header.term_count;
+
+    std::vector<std::string_view> stop_word_views;
+    stop_word_views.reserve(header.stop_word_count);
+    for (uint64_t i = 0; i < header.stop_word_count; ++i) {
+        stop_word_views.push_back(get_string(stop_words[i]));
+    }
+    stop_words_ = StopWordSet(stop_word_views);
+
+    for (uint64_t i = 0; i < header.term_count; ++i) {
+        const SnapshotTerm& term = terms[i];
+        if ((header.blocks_offset + term.blocks_offset) % SNAPSHOT_ALIGNMENT != 0) {
+            throw std::runtime_error("Snapshot file is corrupted"s);
+        }
+        const auto* blocks = GetSnapshotSection<uint8_t>(data, header, header.blocks_offset + term.blocks_offset, term.blocks_size);
+        const auto* postings = GetSnapshotSection<uint8_t>(data, header, header.postings_offset + term.postings_offset, term.postings_size);
+        if (!PostingList::IsValidEncoded(blocks, term.blocks_size, postings, term.postings_size, term.posting_count,
+                header.ordinal_count)) {
+            throw std::runtime_error("Snapshot file is corrupted"s);
+        }
+        if (terms_.AddExternal(get_string(term.text)) != i) {
+            throw std::runtime_error("Snapshot file is corrupted"s);
+        }
+        term_postings_.push_back(PostingList::FromEncoded(blocks, term.blocks_size, postings, term.postings_size, term.posting_count));
+    }
+
+    ordinal_document_ids_.resize(header.ordinal_count, -1);
+    document_ratings_.resize(header.ordinal_count);
+    document_statuses_.resize(header.ordinal_count);
+    documents_.resize(header.ordinal_count);
+    for (uint64_t i = 0; i < header.document_count; ++i) {
+        const SnapshotDocument& snapshot_document = documents[i];
+        if (snapshot_document.ordinal >= header.ordinal_count) {
+            throw std::runtime_error("Snapshot file is corrupted"s);
+        }
+        const int ordinal = snapshot_document.ordinal;
+        if (ordinal_document_ids_[ordinal] != -1 || !document_ordinals_.emplace(snapshot_document.id, ordinal).second) {
+            throw std::runtime_error("Snapshot file is corrupted"s);
+        }
+        ordinal_document_ids_[ordinal] = snapshot_document.id;
+        document_ratings_[ordinal] = snapshot_document.rating;
+        document_statuses_[ordinal] = static_cast<DocumentStatus>(snapshot_document.status);
+        DocumentData& document = documents_[ordinal];
+        document.is_from_snapshot = true;
+        document.text = get_string(snapshot_document.text);
+        document.snapshot_words = GetSnapshotSection<SnapshotWord>(data, header,
+            header.words_offset + snapshot_document.words_offset, snapshot_document.word_count);
+        document.snapshot_word_count = snapshot_document.word_count;
+        document_ids_.insert(document_ids_.end(), snapshot_document.id);
+        if (DocumentIdSet* status_documents = GetStatusDocuments(static_cast<DocumentStatus>(snapshot_document.status))) {
+            status_documents->Insert(ordinal);
+        }
+    }
+    //ordinals left unused by the removed documents of the saved server
+    for (int ordinal = ordinal_document_ids_.size(); ordinal-- > 0;) {
+        if (ordinal_document_ids_[ordinal] == -1) {
+            free_ordinals_.push_back(ordinal);
         }
-        stop_words_.insert(std::string(word));
     }
 }
 
 int SearchServer::GetDocumentCount() const {
-    return SearchServer::documents_.size();
+    return SearchServer::document_ids_.size();
 }
 
 std::map<std::string_view, std::map<int, double>> SearchServer::GetWordToFreqs() const {
-    return word_to_document_freqs_;
+    std::map<std::string_view, std::map<int, double>> result;
+    ForEachTerm([&result](const TermPostings& postings) {
+        auto& document_freqs = result[postings.GetWord()];
+        postings.ForEach([&document_freqs](int document_id, double term_freq) {
+            document_freqs.emplace(document_id, term_freq);
+        });
+    });
+    return result;
+}
+
+std::optional<SearchServer::TermPostings> SearchServer::FindTerm(std::string_view word) const {
+    const std::optional<TermId> term = terms_.Find(word);
+    if (!term) {
+        return std::nullopt;
+    }
+    return TermPostings(*this, *term);
+}
+
+size_t SearchServer::GetTermCount() const {
+    return terms_.size();
+}
+
+SearchServer::TermPostings::TermPostings(const SearchServer& server, TermId term)
+    : server_(&server), term_(term) {
+}
+
+std::string_view SearchServer::TermPostings::GetWord() const {
+    return server_->terms_.GetText(term_);
+}
+
+size_t SearchServer::TermPostings::size() const {
+    return server_->term_postings_[term_].size();
+}
+
+uint64_t SearchServer::GetGeneration() const {
+    return generation_;
+}
+
+std::string SearchServer::GetNormalizedQuery(std::string_view raw_query) const {
+    const Query query = ParseQuery(raw_query, false);
+    std::string result;
+    for (std::string_view word : query.plus_words) {
+        result += (result.empty() ? ""s : " "s) + std::string(word);
+    }
+    for (std::string_view word : query.minus_words) {
+        result += (result.empty() ? "-"s : " -"s) + std::string(word);
+    }
+    return result;
+}
+
+IndexStats SearchServer::GetIndexStats() const {
+    IndexStats stats;
+    for (const PostingList& postings : term_postings_) {
+        stats.posting_count += postings.size();
+        stats.posting_bytes += postings.GetByteSize();
+    }
+    if (stats.posting_count > 0) {
+        stats.bytes_per_posting = stats.posting_bytes * 1.0 / stats.posting_count;
+    }
+    return stats;
+}
+
+void SearchServer::CompactIndex() {
+    for (PostingList& postings : term_postings_) {
+        postings.Compact();
+    }
+    CompactTexts();
+}
+
+void SearchServer::SaveSnapshot(const std::string& path) const {
+    std::string strings;
+    const auto add_string = [&strings](std::string_view text) {
+        const SnapshotString result{strings.size(), text.size()};
+        strings.append(text);
+        return result;
+    };
+
+    std::vector<SnapshotString> stop_words;
+    for (std::string_view word : stop_words_.GetWords()) {
+        stop_words.push_back(add_string(word));
+    }
+
+    //unused term ids are skipped, so the terms get dense indexes in the same order
+    std::vector<SnapshotTerm> terms;
+    std::vector<uint32_t> term_indexes(term_postings_.size());
+    std::vector<uint8_t> blocks;
+    std::vector<uint8_t> postings;
+    for (TermId term_id = 0; term_id < term_postings_.size(); ++term_id) {
+        const PostingList& posting_list = term_postings_[term_id];
+        if (posting_list.empty()) {
+            continue;
+        }
+        SnapshotTerm term{};
+        term.text = add_string(terms_.GetText(term_id));
+        blocks.resize((blocks.size() + SNAPSHOT_ALIGNMENT - 1) / SNAPSHOT_ALIGNMENT * SNAPSHOT_ALIGNMENT);
+        term.blocks_offset = blocks.size();
+        term.postings_offset = postings.size();
+        posting_list.AppendEncoded(blocks, postings);
+        term.blocks_size = blocks.size() - term.blocks_offset;
+        term.postings_size = postings.size() - term.postings_offset;
+        term.posting_count = posting_list.size();
+        term_indexes[term_id] = terms.size();
+        terms.push_back(term);
+    }
+
+    std::vector<SnapshotDocument> documents;
+    std::vector<SnapshotWord> words;
+    for (const int document_id : document_ids_) {
+        const int ordinal = document_ordinals_.at(document_id);
+        const DocumentData& document = documents_[ordinal];
+        const auto& term_freqs = GetDocumentTermFreqs(document);
+        SnapshotDocument snapshot_document{};
+        snapshot_document.id = document_id;
+        snapshot_document.rating = document_ratings_[ordinal];
+        snapshot_document.status = static_cast<int32_t>(document_statuses_[ordinal]);
+        snapshot_document.word_count = term_freqs.size();
+        snapshot_document.ordinal = ordinal;
+        snapshot_document.text = add_string(document.text);
+        snapshot_document.words_offset = words.size() * sizeof(SnapshotWord);
+        for (const auto& [term, term_freq] : term_freqs) {
+            SnapshotWord snapshot_word{};
+            snapshot_word.term_index = term_indexes[term];
+            snapshot_word.term_freq = term_freq;
+            words.push_back(snapshot_word);
+        }
+        documents.push_back(snapshot_document);
+    }
+
+    SnapshotHeader header{};
+    std::memcpy(header.magic, SNAPSHOT_MAGIC, sizeof(header.magic));
+    header.version = SNAPSHOT_VERSION;
+    header.byte_order_mark = SNAPSHOT_BYTE_ORDER_MARK;
+    header.stop_word_count = stop_words.size();
+    header.term_count = terms.size();
+    header.document_count = documents.size();
+    header.ordinal_count = ordinal_document_ids_.size();
+
+    uint64_t file_size = sizeof(header);
+    const auto place_section = [&file_size](size_t size) {
+        file_size = (file_size + SNAPSHOT_ALIGNMENT - 1) / SNAPSHOT_ALIGNMENT * SNAPSHOT_ALIGNMENT;
+        const uint64_t offset = file_size;
+        file_size += size;
+        return offset;
+    };
+    header.stop_words_offset = place_section(stop_words.size() * sizeof(SnapshotString));
+    header.terms_offset = place_section(terms.size() * sizeof(SnapshotTerm));
+    header.documents_offset = place_section(documents.size() * sizeof(SnapshotDocument));
+    header.words_offset = place_section(words.size() * sizeof(SnapshotWord));
+    header.blocks_offset = place_section(blocks.size());
+    header.postings_offset = place_section(postings.size());
+    header.strings_offset = place_section(strings.size());
+    header.file_size = file_size;
+
+    //the snapshot is written next to the target and renamed over it, so servers
+    //still mapping the previous file at this path keep reading valid pages
+    const std::string temporary_path = path + ".tmp"s;
+    std::ofstream out(temporary_path, std::ios::binary | std::ios::trunc);
+    if (!out) {
+        throw std::runtime_error("Can't create snapshot file "s + temporary_path);
+    }
+    uint64_t written = 0;
+    const auto write_section = [&out, &written](uint64_t offset, const void* data, size_t size) {
+        static const char padding[SNAPSHOT_ALIGNMENT] = {};
+        out.write(padding, offset - written);
+        out.write(static_cast<const char*>(data), size);
+        written = offset + size;
+    };
+    write_section(0, &header, sizeof(header));
+    write_section(header.stop_words_offset, stop_words.data(), stop_words.size() * sizeof(SnapshotString));
+    write_section(header.terms_offset, terms.data(), terms.size() * sizeof(SnapshotTerm));
+    write_section(header.documents_offset, documents.data(), documents.size() * sizeof(SnapshotDocument));
+    write_section(header.words_offset, words.data(), words.size() * sizeof(SnapshotWord));
+    write_section(header.blocks_offset, blocks.data(), blocks.size());
+    write_section(header.postings_offset, postings.data(), postings.size());
+    write_section(header.strings_offset, strings.data(), strings.size());
+    out.close();
+    if (!out || std::rename(temporary_path.c_str(), path.c_str()) != 0) {
+        std::remove(temporary_path.c_str());
+        throw std::runtime_error("Can't write snapshot file "s + path);
+    }
+}
+
+SearchServer SearchServer::LoadSnapshot(const std::string& path) {
+    return SearchServer(std::make_shared<LoadedSnapshot>(path));
 }
 
 void SearchServer::AddDocument(int document_id, std::string_view document, DocumentStatus status, const std::vector<int>& ratings) {
     if (document_id < 0) {
         throw std::invalid_argument("Document id("s + std::to_string(document_id) + ") is less then 0"s);
     }
-    if (documents_.find(document_id) != documents_.end()) {
+    if (document_ordinals_.count(document_id) > 0) {
         throw std::invalid_argument("There is already a document in document list with id: "s + std::to_string(document_id));
     }
-    if (SearchServer::StringHasSpecialSymbols(document)) {
+    //the words are found and checked in one pass over the caller's text, before anything is changed
+    std::vector<std::string_view> words;
+    if (!SplitIntoWordsNoStop(document, words)) {
         throw std::invalid_argument("There is a special symbol in document: "s + std::string(document));
     }
 
-    documents_[document_id].text = std::string(document);
-    documents_[document_id].rating = ComputeAverageRating(ratings);
-    documents_[document_id].status = status;
+    const int ordinal = InsertDocument(document_id, document, status, ratings);
+    DocumentData& document_data = documents_[ordinal];
+    for (const auto& [word, posting] : IndexDocumentWords(ordinal, words)) {
+        const TermId term = AddTerm(word);
+        term_postings_[term].Add(posting.document_id, posting.term_count, posting.word_count);
+        document_data.term_freqs.push_back({term, ComputeTermFreq(posting.term_count, posting.word_count)});
+    }
+    std::sort(document_data.term_freqs.begin(), document_data.term_freqs.end(), [](const TermFreq& lhs, const TermFreq& rhs) {
+        return lhs.term < rhs.term;
+    });
+    ++generation_;
+}
 
-    const std::vector<std::string_view> words = SplitIntoWordsNoStop(documents_[document_id].text);
-    const double inv_word_count = 1.0 / words.size();
-    std::map<std::string_view, double> word_freqs;
-    for (const std::string_view word : words) {
-        word_to_document_freqs_[word][document_id] += inv_word_count;
-        word_freqs[word] += inv_word_count;
+void SearchServer::AddDocuments(const std::vector<DocumentToAdd>& documents) {
+    AddDocuments(std::execution::seq, documents);
+}
+
+std::string SearchServer::DescribeInvalidDocuments(const std::vector<DocumentToAdd>& documents, const std::vector<char>& has_special_symbols) const {
+    std::string errors;
+    std::set<int> batch_ids;
+    for (size_t i = 0; i < documents.size(); ++i) {
+        const int document_id = documents[i].id;
+        std::string error;
+        if (document_id < 0) {
+            error = "id is less then 0"s;
+        } else if (document_ordinals_.count(document_id) > 0) {
+            error = "there is already a document with this id"s;
+        } else if (!batch_ids.insert(document_id).second) {
+            error = "id is repeated in the batch"s;
+        } else if (has_special_symbols[i]) {
+            error = "there is a special symbol in document"s;
+        }
+        if (!error.empty()) {
+            errors += (errors.empty() ? ""s : "; "s) + std::to_string(document_id) + ": "s + error;
+        }
+    }
+    return errors;
+}
+
+// Creates the metadata of the batch documents, their words are indexed afterwards
+std::vector<int> SearchServer::InsertNewDocuments(const std::vector<DocumentToAdd>& documents) {
+    std::vector<int> ordinals;
+    ordinals.reserve(documents.size());
+    for (const DocumentToAdd& document : documents) {
+        ordinals.push_back(InsertDocument(document.id, document.text, document.status, document.ratings));
     }
-    documents_[document_id].word_count = word_freqs;
+    return ordinals;
+}
+
+// Gives the document an ordinal and fills its metadata, returns the ordinal
+int SearchServer::InsertDocument(int document_id, std::string_view text, DocumentStatus status, const std::vector<int>& ratings) {
+    int ordinal;
+    if (free_ordinals_.empty()) {
+        ordinal = ordinal_document_ids_.size();
+        ordinal_document_ids_.push_back(document_id);
+        document_ratings_.push_back(0);
+        document_statuses_.push_back(status);
+        documents_.emplace_back();
+    } else {
+        ordinal = free_ordinals_.back();
+        free_ordinals_.pop_back();
+        ordinal_document_ids_[ordinal] = document_id;
+    }
+    document_ratings_[ordinal] = ComputeAverageRating(ratings);
+    document_statuses_[ordinal] = status;
+    documents_[ordinal].text = texts_.Add(text);
     document_ids_.insert(document_id);
+    document_ordinals_.emplace(document_id, ordinal);
+    if (DocumentIdSet* status_documents = GetStatusDocuments(status)) {
+        status_documents->Insert(ordinal);
+    }
+    return ordinal;
+}
+
+int SearchServer::GetOrdinal(int document_id) const {
+    return document_ordinals_.at(document_id);
+}
+
+std::vector<SearchServer::WordPosting> SearchServer::IndexDocumentWords(int ordinal, const std::vector<std::string_view>& words) {
+    std::map<std::string_view, uint32_t> word_counts;
+    for (const std::string_view word : words) {
+        ++word_counts[word];
+    }
+    std::vector<WordPosting> postings;
+    postings.reserve(word_counts.size());
+    for (const auto [word, term_count] : word_counts) {
+        const uint32_t word_count = words.size();
+        postings.push_back({word, RawPosting{ordinal, term_count, word_count}});
+    }
+    return postings;
+}
+
+// Only reads the dictionary, so the term frequencies of different documents can be found concurrently
+std::vector<SearchServer::TermFreq> SearchServer::GetTermFreqs(const std::vector<WordPosting>& postings) const {
+    std::vector<TermFreq> term_freqs;
+    term_freqs.reserve(postings.size());
+    for (const auto& [word, posting] : postings) {
+        term_freqs.push_back({*terms_.Find(word), ComputeTermFreq(posting.term_count, posting.word_count)});
+    }
+    std::sort(term_freqs.begin(), term_freqs.end(), [](const TermFreq& lhs, const TermFreq& rhs) {
+        return lhs.term < rhs.term;
+    });
+    return term_freqs;
+}
+
+// Returns the id of the word, a new term gets an empty posting list
+TermId SearchServer::AddTerm(std::string_view word) {
+    const TermId term = terms_.Add(word);
+    if (term == term_postings_.size()) {
+        term_postings_.emplace_back();
+    }
+    return term;
+}
+
+std::vector<Document> SearchServer::FindTopDocuments(std::string_view raw_query, DocumentStatus status, int max_result_count) const {
+    return FindTopDocuments(std::execution::seq, raw_query, status, max_result_count);
 }
 
 std::vector<Document> SearchServer::FindTopDocuments(std::string_view raw_query, DocumentStatus status) const {
@@ -77,59 +558,249 @@ std::vector<Document> SearchServer::FindTopDocuments(std::string_view raw_query)
     return SearchServer::FindTopDocuments(std::execution::seq, raw_query);
 }
 
+std::vector<SearchServer::BatchQuery> SearchServer::ParseBatchQueries(const std::vector<std::string>& raw_queries,
+    std::vector<WeightedPostings>& terms) const {
+    std::unordered_map<TermId, size_t> term_indexes;
+    std::vector<BatchQuery> queries;
+    queries.reserve(raw_queries.size());
+    for (const std::string& raw_query : raw_queries) {
+        const Query query = ParseQuery(raw_query, false);
+        BatchQuery& batch_query = queries.emplace_back();
+        for (const TermId term : query.plus_terms) {
+            const auto [it, inserted] = term_indexes.emplace(term, terms.size());
+            if (inserted) {
+                terms.push_back({&term_postings_[term], ComputeWordInverseDocumentFreq(term_postings_[term])});
+            }
+            batch_query.plus_terms.push_back(it->second);
+        }
+        std::vector<int> excluded_ids;
+        if (!batch_query.plus_terms.empty()) {
+            for (const TermId term : query.minus_terms) {
+                term_postings_[term].ForEach([&excluded_ids](const Posting& posting) {
+                    excluded_ids.push_back(posting.document_id);
+                });
+            }
+        }
+        batch_query.excluded_documents = DocumentIdSet(std::move(excluded_ids));
+    }
+    return queries;
+}
+
+//the window loop of ScoreDocumentRange turned inside out: the postings of every term in the window are decoded once,
+//then every query sums them up in the order of its own words, so relevance is exactly the same as for a single query
+void SearchServer::ScoreBatchRange(int64_t first_ordinal, int64_t last_ordinal, const std::vector<WeightedPostings>& terms,
+    const std::vector<BatchQuery>& queries, DocumentStatus status, std::vector<TopDocuments>& query_tops) const {
+    std::vector<PostingList::Cursor> cursors;
+    cursors.reserve(terms.size());
+    for (const WeightedPostings& term : terms) {
+        cursors.push_back(term.postings->GetCursor());
+        cursors.back().SkipTo(first_ordinal);
+    }
+
+    std::vector<std::vector<Posting>> window_postings(terms.size());
+    std::vector<double> relevance(SCORING_WINDOW_SIZE);
+    std::vector<char> is_matched(SCORING_WINDOW_SIZE, 0);
+    std::vector<char> is_excluded(SCORING_WINDOW_SIZE, 0);
+    std::vector<int> matched_offsets;
+    matched_offsets.reserve(SCORING_WINDOW_SIZE);
+
+    while (true) {
+        int64_t window_begin = last_ordinal;
+        for (const PostingList::Cursor& cursor : cursors) {
+            if (!cursor.AtEnd()) {
+                window_begin = std::min<int64_t>(window_begin, cursor.NextDocumentId());
+            }
+        }
+        if (window_begin >= last_ordinal) {
+            break;
+        }
+        const int64_t window_end = std::min(last_ordinal, window_begin + SCORING_WINDOW_SIZE);
+        for (size_t t = 0; t < terms.size(); ++t) {
+            window_postings[t].clear();
+            cursors[t].ForEachBefore(window_end, [&postings = window_postings[t]](const Posting& posting) {
+                postings.push_back(posting);
+            });
+        }
+        for (size_t q = 0; q < queries.size(); ++q) {
+            const BatchQuery& query = queries[q];
+            if (std::all_of(query.plus_terms.begin(), query.plus_terms.end(), [&window_postings](size_t t) {
+                    return window_postings[t].empty();
+                })) {
+                continue;
+            }
+            query.excluded_documents.ForEachInRange(window_begin, window_end, [&](int ordinal) {
+                is_excluded[ordinal - window_begin] = 1;
+            });
+            for (const size_t t : query.plus_terms) {
+                const double inverse_document_freq = terms[t].inverse_document_freq;
+                for (const Posting& posting : window_postings[t]) {
+                    const int offset = posting.document_id - window_begin;
+                    if (is_excluded[offset]) {
+                        continue;
+                    }
+                    if (!is_matched[offset]) {
+                        is_matched[offset] = 1;
+                        relevance[offset] = 0.0;
+                        matched_offsets.push_back(offset);
+                    }
+                    relevance[offset] += posting.term_freq * inverse_document_freq;
+                }
+            }
+            query.excluded_documents.ForEachInRange(window_begin, window_end, [&](int ordinal) {
+                is_excluded[ordinal - window_begin] = 0;
+            });
+
+            TopDocuments& top_documents = query_tops[q];
+            for (int offset : matched_offsets) {
+                is_matched[offset] = 0;
+                if (relevance[offset] < top_documents.GetMinRelevance() - 2 * RELEVANCE_THRESHOLD) {
+                    continue;
+                }
+                const int ordinal = window_begin + offset;
+                //the status is checked per matched document, a rare word doesn't pay for the window
+                const DocumentStatus document_status = document_statuses_[ordinal];
+                if (document_status != status) {
+                    continue;
+                }
+                top_documents.Push(Document(ordinal_document_ids_[ordinal], relevance[offset], document_ratings_[ordinal], document_status));
+            }
+            matched_offsets.clear();
+        }
+    }
+}
+
+void QueryStats::Merge(const QueryStats& other) {
+    document_count += other.document_count;
+    for (const auto& [word, document_freq] : other.document_freqs) {
+        document_freqs[word] += document_freq;
+    }
+}
+
+QueryStats SearchServer::GetQueryStats(std::string_view raw_query) const {
+    const Query query = ParseQuery(raw_query, false);
+    QueryStats stats;
+    stats.document_count = GetDocumentCount();
+    for (std::string_view word : query.plus_words) {
+        const std::optional<TermId> term = terms_.Find(word);
+        stats.document_freqs.emplace(word, term ? term_postings_[*term].size() : 0);
+    }
+    return stats;
+}
+
 using MatchDocumentResult = std::tuple<std::vector<std::string_view>, DocumentStatus>;
 MatchDocumentResult SearchServer::MatchDocument(
     const std::execution::sequenced_policy&, std::string_view raw_query, int document_id) const {
         const Query query = ParseQuery(raw_query, false);
+        const int ordinal = GetOrdinal(document_id);
         std::vector<std::string_view> matched_words;
-        for (std::string_view word : query.minus_words) {
-            if (word_to_document_freqs_.count(word) == 0) {
-                continue;
-            }
-            if (word_to_document_freqs_.at(word).count(document_id)) {
-                return {matched_words, documents_.at(document_id).status};
+        for (const TermId term : query.minus_terms) {
+            if (term_postings_[term].Contains(ordinal)) {
+                return {matched_words, document_statuses_[ordinal]};
             }
         }
-        for (std::string_view word : query.plus_words) {
-            if (word_to_document_freqs_.count(word) == 0) {
-                continue;
-            }
-            if (word_to_document_freqs_.at(word).count(document_id)) {
-                matched_words.push_back(word);
+        for (const TermId term : query.plus_terms) {
+            if (term_postings_[term].Contains(ordinal)) {
+                matched_words.push_back(terms_.GetText(term));
             }
         }
-        return {matched_words, documents_.at(document_id).status};
+        return {matched_words, document_statuses_[ordinal]};
 }
 
 MatchDocumentResult SearchServer::MatchDocument(std::string_view raw_query, int document_id) const {
     return MatchDocument(std::execution::seq, raw_query, document_id);
 }
 
-MatchDocumentResult SearchServer::MatchDocument(
-    const std::execution::parallel_policy&, std::string_view raw_query, int document_id) const {
+template<typename ExecutionPolicy>
+MatchDocumentResult SearchServer::MatchDocumentInParallel(const ExecutionPolicy& policy, std::string_view raw_query, int document_id) const {
         Query query = ParseQuery(raw_query, true);
+        const int ordinal = GetOrdinal(document_id);
 
-        const auto word_checker = 
-            [this, document_id](std::string_view word) {
-                const auto it = word_to_document_freqs_.find(word);
-                return it != word_to_document_freqs_.end() && it -> second.count(document_id);
+        const auto term_checker = 
+            [this, ordinal](TermId term) {
+                return term_postings_[term].Contains(ordinal);
             };
 
-        if (std::any_of(query.minus_words.begin(), query.minus_words.end(), word_checker)) {
-            return {{}, documents_.at(document_id).status};
+        if (std::any_of(query.minus_terms.begin(), query.minus_terms.end(), term_checker)) {
+            return {std::vector<std::string_view>{}, document_statuses_[ordinal]};
+        }
+
+        std::vector<char> term_matched(query.plus_terms.size());
+        ParallelFor(policy, query.plus_terms.size(), [&](size_t i) {
+            term_matched[i] = term_checker(query.plus_terms[i]);
+        });
+        std::vector<std::string_view> matched_words;
+        for (size_t i = 0; i < query.plus_terms.size(); ++i) {
+            if (term_matched[i]) {
+                matched_words.push_back(terms_.GetText(query.plus_terms[i]));
+            }
         }
+        ParallelSort(policy, matched_words.begin(), matched_words.end(), std::less<std::string_view>());
+        matched_words.erase(std::unique(matched_words.begin(), matched_words.end()), matched_words.end());
+        return {matched_words, document_statuses_[ordinal]};
+}
 
-        std::vector<std::string_view> matched_words(query.plus_words.size());
-        auto words_end = copy_if(
-            std::execution::par,
-            query.plus_words.begin(), query.plus_words.end(),
-            matched_words.begin(),
-            word_checker
-        );
-        std::sort(std::execution::par, matched_words.begin(), words_end);
-        words_end = std::unique(matched_words.begin(), words_end);
-        matched_words.erase(words_end, matched_words.end());
-        return {matched_words, documents_.at(document_id).status};
+MatchDocumentResult SearchServer::MatchDocument(
+    const std::execution::parallel_policy& policy, std::string_view raw_query, int document_id) const {
+    return MatchDocumentInParallel(policy, raw_query, document_id);
+}
+
+MatchDocumentResult SearchServer::MatchDocument(const ThreadPoolPolicy& policy, std::string_view raw_query, int document_id) const {
+    return MatchDocumentInParallel(policy, raw_query, document_id);
+}
+
+std::vector<MatchDocumentResult> SearchServer::MatchDocuments(std::string_view raw_query, const std::vector<int>& document_ids) const {
+    return MatchDocuments(std::execution::seq, raw_query, document_ids);
+}
+
+SearchServer::MatchQuery SearchServer::ParseMatchQuery(std::string_view raw_query) const {
+    Query query = ParseQuery(raw_query, false);
+    MatchQuery match_query;
+    for (size_t i = 0; i < query.plus_terms.size(); ++i) {
+        match_query.plus_terms.emplace_back(query.plus_terms[i], i);
+    }
+    std::sort(match_query.plus_terms.begin(), match_query.plus_terms.end());
+    match_query.ordered_plus_terms = std::move(query.plus_terms);
+    match_query.minus_terms = std::move(query.minus_terms);
+    std::sort(match_query.minus_terms.begin(), match_query.minus_terms.end());
+    return match_query;
+}
+
+//both term lists are sorted by id, so every lookup continues from where the previous one stopped
+//and a document is read once per query however many words the query has
+MatchDocumentResult SearchServer::MatchOrdinal(const MatchQuery& query, int ordinal) const {
+    const std::vector<TermFreq>& term_freqs = GetDocumentTermFreqs(documents_[ordinal]);
+    const auto term_less = [](const TermFreq& term_freq, TermId term) {
+        return term_freq.term < term;
+    };
+    auto it = term_freqs.begin();
+    for (const TermId term : query.minus_terms) {
+        it = std::lower_bound(it, term_freqs.end(), term, term_less);
+        if (it == term_freqs.end()) {
+            break;
+        }
+        if (it->term == term) {
+            return {std::vector<std::string_view>{}, document_statuses_[ordinal]};
+        }
+    }
+
+    std::vector<size_t> matched_indexes;
+    it = term_freqs.begin();
+    for (const auto& [term, index] : query.plus_terms) {
+        it = std::lower_bound(it, term_freqs.end(), term, term_less);
+        if (it == term_freqs.end()) {
+            break;
+        }
+        if (it->term == term) {
+            matched_indexes.push_back(index);
+        }
+    }
+    std::sort(matched_indexes.begin(), matched_indexes.end());
+    std::vector<std::string_view> matched_words;
+    matched_words.reserve(matched_indexes.size());
+    for (const size_t index : matched_indexes) {
+        matched_words.push_back(terms_.GetText(query.ordered_plus_terms[index]));
+    }
+    return {matched_words, document_statuses_[ordinal]};
 }
 
 std::set<int>::const_iterator SearchServer::begin() const {
@@ -140,72 +811,83 @@ std::set<int>::const_iterator SearchServer::end() const {
     return document_ids_.end();
 }
 
-const std::map<std::string_view, double>& SearchServer::GetWordFrequencies(int document_id) const {
-    if (document_ids_.count(document_id) > 0) {
-        return documents_.at(document_id).word_count;
+std::map<std::string_view, double> SearchServer::GetWordFrequencies(int document_id) const {
+    std::map<std::string_view, double> word_freqs;
+    if (const auto it = document_ordinals_.find(document_id); it != document_ordinals_.end()) {
+        for (const auto& [term, term_freq] : GetDocumentTermFreqs(documents_[it->second])) {
+            word_freqs.emplace(terms_.GetText(term), term_freq);
+        }
     }
-    static const std::map<std::string_view, double> empty_map = {};
-    return empty_map;
+    return word_freqs;
 }
 
 void SearchServer::RemoveDocument(int document_id) {
-    if (document_ids_.count(document_id) == 0) {
+    const auto it = document_ordinals_.find(document_id);
+    if (it == document_ordinals_.end()) {
         return;
     }
-    for (auto [key, value] : documents_.at(document_id).word_count) {
-        if (word_to_document_freqs_[key].size() == 1) {
-            word_to_document_freqs_.erase(key);
-        }
-        else {
-            word_to_document_freqs_[key].erase(document_id);
-        }
+    const int ordinal = it->second;
+    for (const auto& [term, _] : GetDocumentTermFreqs(documents_[ordinal])) {
+        term_postings_[term].Remove(ordinal);
+        ReleaseTerm(term);
     }
-    documents_.erase(document_id);
-    document_ids_.erase(document_id);
+    EraseDocument(ordinal);
 }
 
 void SearchServer::RemoveDocument(const std::execution::sequenced_policy& policy, int document_id) {
     RemoveDocument(document_id);
 }
 
-void SearchServer::RemoveDocument(const std::execution::parallel_policy& policy, int document_id) {
-    if (document_ids_.count(document_id) == 0) {
+template<typename ExecutionPolicy>
+void SearchServer::RemoveDocumentInParallel(const ExecutionPolicy& policy, int document_id) {
+    const auto it = document_ordinals_.find(document_id);
+    if (it == document_ordinals_.end()) {
         return;
     }
-    auto words = documents_.at(document_id).word_count;
-    std::vector<const std::string_view*> tmp_vector;
-    tmp_vector.reserve(words.size());
-    std::transform(policy, 
-        words.begin(), 
-        words.end(),
-        tmp_vector.begin(),
-        [&](const auto &pair){
-            return &pair.first;
-        });
-    
-    std::for_each(policy, 
-        tmp_vector.begin(), 
-        tmp_vector.end(), 
-        [this, document_id](const auto &key) {
-            word_to_document_freqs_[*key].erase(document_id);
-        }
-    );
-    documents_.erase(document_id);
-    document_ids_.erase(document_id);
+    const int ordinal = it->second;
+    const auto& term_freqs = GetDocumentTermFreqs(documents_[ordinal]);
+    ParallelFor(policy, term_freqs.size(), [&](size_t i) {
+        term_postings_[term_freqs[i].term].Remove(ordinal);
+    });
+    for (const TermFreq& term_freq : term_freqs) {
+        ReleaseTerm(term_freq.term);
+    }
+    EraseDocument(ordinal);
+}
+
+void SearchServer::RemoveDocument(const std::execution::parallel_policy& policy, int document_id) {
+    RemoveDocumentInParallel(policy, document_id);
+}
+
+void SearchServer::RemoveDocument(const ThreadPoolPolicy& policy, int document_id) {
+    RemoveDocumentInParallel(policy, document_id);
+}
+
+DocumentIdSet* SearchServer::GetStatusDocuments(DocumentStatus status) {
+    const int index = static_cast<int>(status);
+    return index >= 0 && index < DOCUMENT_STATUS_COUNT ? &status_documents_[index] : nullptr;
+}
+
+const DocumentIdSet* SearchServer::GetStatusDocuments(DocumentStatus status) const {
+    const int index = static_cast<int>(status);
+    return index >= 0 && index < DOCUMENT_STATUS_COUNT ? &status_documents_[index] : nullptr;
 }
 
 bool SearchServer::IsStopWord(std::string_view word) const {
-    return stop_words_.count(std::string(word)) > 0;
+    return stop_words_.Contains(word);
 }
 
-std::vector<std::string_view> SearchServer::SplitIntoWordsNoStop(std::string_view text) const {
-    std::vector<std::string_view> words;
-    for (std::string_view word : SplitIntoWords(text)) {
-        if (!IsStopWord(word)) {
-            words.push_back(word);
+bool SearchServer::SplitIntoWordsNoStop(std::string_view text, std::vector<std::string_view>& words) const {
+    const WordSplitter splitter(text);
+    for (auto it = splitter.begin(); it != splitter.end(); ++it) {
+        if (it.HasSpecialSymbols()) {
+            return false;
+        }
+        if (!IsStopWord(*it)) {
+            words.push_back(*it);
         }
     }
-    return words;
+    return true;
 }
 
 SearchServer::QueryWord SearchServer::ParseQueryWord(std::string_view text) const {
@@ -226,14 +908,16 @@ SearchServer::QueryWord SearchServer::ParseQueryWord(std::string_view text) cons
 
 SearchServer::Query SearchServer::ParseQuery(std::string_view text, bool skip_sort) const {
     Query query;
-    for (std::string_view word : SplitIntoWords(text)) {
+    const WordSplitter splitter(text);
+    for (auto it = splitter.begin(); it != splitter.end(); ++it) {
+        const std::string_view word = *it;
         if (word[0] == '-' && word[1] == '-') {
             throw std::invalid_argument("There is a word with double minus(--) in the search query");
         }
         if (word[0] == '-' && word.size() == 1) {
             throw std::invalid_argument("There is a single minus( - ) in the search query");
         }
-        if (SearchServer::StringHasSpecialSymbols(word)) {
+        if (it.HasSpecialSymbols()) {
             throw std::invalid_argument("There is a special symbol in the search query");
         }
         const QueryWord query_word = ParseQueryWord(word);
@@ -251,17 +935,84 @@ SearchServer::Query SearchServer::ParseQuery(std::string_view text, bool skip_so
             words->erase(std::unique(words->begin(), words->end()), words->end());
         }
     }
+    //every word is looked up once, the index is then read by term ids
+    for (const auto& [words, terms] : {std::pair{&query.plus_words, &query.plus_terms}, std::pair{&query.minus_words, &query.minus_terms}}) {
+        for (std::string_view word : *words) {
+            if (const std::optional<TermId> term = terms_.Find(word)) {
+                terms->push_back(*term);
+            }
+        }
+    }
     return query;
 }
 
-double SearchServer::ComputeWordInverseDocumentFreq(std::string_view word) const {
-    return log(GetDocumentCount() * 1.0 / word_to_document_freqs_.at(word).size());
+double SearchServer::ComputeWordInverseDocumentFreq(const PostingList& postings) const {
+    return postings.GetInverseDocumentFreq(GetDocumentCount());
+}
+
+void SearchServer::ReleaseTerm(TermId term) {
+    if (term_postings_[term].empty()) {
+        term_postings_[term] = PostingList();
+        terms_.Remove(term);
+    }
+}
+
+// Drops the document metadata and text once its words are released, the ordinal is reused later
+void SearchServer::EraseDocument(int ordinal) {
+    const int document_id = ordinal_document_ids_[ordinal];
+    if (DocumentIdSet* status_documents = GetStatusDocuments(document_statuses_[ordinal])) {
+        status_documents->Erase(ordinal);
+    }
+    if (!documents_[ordinal].is_from_snapshot) {
+        texts_.Release(documents_[ordinal].text);
+    }
+    documents_[ordinal] = DocumentData();
+    ordinal_document_ids_[ordinal] = -1;
+    free_ordinals_.push_back(ordinal);
+    document_ordinals_.erase(document_id);
+    document_ids_.erase(document_id);
+    ++generation_;
+    //compaction copies every live text, so it waits until as much space is unused
+    if (texts_.GetDeadSize() > std::max(texts_.GetLiveSize(), TEXT_ARENA_CHUNK_SIZE)) {
+        CompactTexts();
+    }
+}
+
+// Copies the live texts into a new arena, the index refers to terms by ids, so nothing else moves
+void SearchServer::CompactTexts() {
+    TextArena texts;
+    for (DocumentData& document : documents_) {
+        if (!document.is_from_snapshot) {
+            document.text = texts.Add(document.text);
+        }
+    }
+    texts_ = std::move(texts);
 }
 
-void SearchServer::ApplyMaxResultDocumentCount(std::vector<Document>& docs) {
-    if (docs.size() > MAX_RESULT_DOCUMENT_COUNT) {
-        docs.resize(MAX_RESULT_DOCUMENT_COUNT);
+// Term ids of a document loaded from a snapshot are the term indexes of its snapshot words.
+// Documents are built once, under a mutex shared by a few documents, so parallel readers of
+// different documents rarely wait for each other
+const std::vector<SearchServer::TermFreq>& SearchServer::GetDocumentTermFreqs(const DocumentData& document) const {
+    if (document.snapshot_words.load(std::memory_order_acquire) == nullptr) {
+        return document.term_freqs;
     }
+    const size_t ordinal = &document - documents_.data();
+    std::lock_guard guard(snapshot_->term_freqs_mutexes[ordinal % LoadedSnapshot::TERM_FREQS_MUTEX_COUNT]);
+    const SnapshotWord* snapshot_words = document.snapshot_words.load(std::memory_order_relaxed);
+    if (snapshot_words != nullptr) {
+        std::vector<TermFreq> term_freqs;
+        term_freqs.reserve(document.snapshot_word_count);
+        for (size_t i = 0; i < document.snapshot_word_count; ++i) {
+            const SnapshotWord& word = snapshot_words[i];
+            if (word.term_index >= snapshot_->term_count) {
+                throw std::runtime_error("Snapshot file is corrupted"s);
+            }
+            term_freqs.push_back({word.term_index, word.term_freq});
+        }
+        document.term_freqs = std::move(term_freqs);
+        document.snapshot_words.store(nullptr, std::memory_order_release);
+    }
+    return document.term_freqs;
 }
 
 int SearchServer::ComputeAverageRating(const std::vector<int>& ratings) {
@@ -273,11 +1024,5 @@ int SearchServer::ComputeAverageRating(const std::vector<int>& ratings) {
 }
 
 bool SearchServer::StringHasSpecialSymbols(std::string_view s) const {
-    std::string tmp_str = static_cast<std::string>(s);
-    for (const auto& c : s) {
-            if (int(c) <= 31 && int(c) >= 0) {
-                return true;
-            }
-        }
-    return false;
+    return HasSpecialSymbols(s);
 }
\ No newline at end of file
@@ -2,31 +2,105 @@
 
 #include <vector>
 #include <set>
+#include <array>
 #include <unordered_set>
+#include <unordered_map>
+#include <optional>
 #include <string>
 #include <map>
+#include <deque>
 #include <stdexcept>
 #include <execution>
 #include <string_view>
 #include <future>
 #include <iterator>
 #include <type_traits>
+#include <numeric>
+#include <thread>
+#include <cstdint>
+#include <limits>
+#include <memory>
+#include <mutex>
+#include <atomic>
 
 #include "document.h"
 #include "string_processing.h"
 #include "log_duration.h"
 #include "concurrent_map.h"
+#include "posting_list.h"
+#include "top_documents.h"
+#include "thread_pool.h"
+#include "snapshot.h"
+#include "document_id_set.h"
+#include "text_arena.h"
+#include "stop_word_set.h"
+#include "term_dictionary.h"
 
-static constexpr double RELEVANCE_THRESHOLD = 1e-6;
 static const int MAX_RESULT_DOCUMENT_COUNT = 5;
+//documents are scored in windows of consecutive ids using dense accumulator arrays of this size
+static const int SCORING_WINDOW_SIZE = 4096;
+//queries for at most this many documents skip documents which can't get into the result (MaxScore)
+static const int MAX_PRUNED_RESULT_COUNT = 100;
 
 using namespace std::string_literals;
+
+struct IndexStats {
+    size_t posting_count = 0;
+    size_t posting_bytes = 0;
+    double bytes_per_posting = 0.0;
+};
+
+struct DocumentToAdd {
+    int id;
+    std::string_view text;
+    DocumentStatus status;
+    std::vector<int> ratings;
+};
+
+//document frequencies of the plus words of a query in a collection of documents,
+//used to score documents of one server with the statistics of several servers
+struct QueryStats {
+    int document_count = 0;
+    std::map<std::string, int, std::less<>> document_freqs;
+
+    void Merge(const QueryStats& other);
+};
+
 class SearchServer {
 public:
+    //non-owning view of the postings of one term, valid until the server is modified.
+    //Like queries, it can be read from several threads at once; use VersionedSearchServer::Read
+    //to read it next to a writer
+    class TermPostings {
+    public:
+        std::string_view GetWord() const;
+
+        //number of documents with the term
+        size_t size() const;
+
+        //calls func(document_id, term_freq) for every document with the term, decoding the
+        //postings block by block. Documents come in internal order, not sorted by id
+        template <typename Func>
+        void ForEach(Func func) const;
+
+    private:
+        friend class SearchServer;
+
+        TermPostings(const SearchServer& server, TermId term);
+
+        const SearchServer* server_;
+        TermId term_;
+    };
 
 
     SearchServer();
 
+    //the copy gets its own copies of the document and term texts
+    SearchServer(const SearchServer& other);
+    SearchServer(SearchServer&&) = default;
+    SearchServer& operator=(const SearchServer& other);
+    SearchServer& operator=(SearchServer&&) = default;
+
     SearchServer(const std::string& text);
     SearchServer(std::string_view text);
 
@@ -35,17 +109,68 @@ public:
 
     int GetDocumentCount() const;
 
+    //copies the whole index, FindTerm and ForEachTerm read it in place
     std::map<std::string_view, std::map<int, double>> GetWordToFreqs() const;
+
+    std::optional<TermPostings> FindTerm(std::string_view word) const;
+
+    //calls func(const TermPostings&) for every term of the index, in no particular order
+    template <typename Func>
+    void ForEachTerm(Func func) const;
+
+    size_t GetTermCount() const;
+
+    //incremented by every change of the document set, results of a query can be reused while it stays the same
+    uint64_t GetGeneration() const;
+
+    //canonical form of the query: sorted unique plus words followed by sorted unique minus words.
+    //Queries with the same normalized form have the same results
+    std::string GetNormalizedQuery(std::string_view raw_query) const;
+
+    //memory used by the compressed posting lists
+    IndexStats GetIndexStats() const;
+
+    //compresses postings still kept in the append buffers of the posting lists
+    //and moves the document texts together, reclaiming the space of removed documents
+    void CompactIndex();
+
+    //writes the index, document metadata and texts to a binary snapshot file, see snapshot.h
+    void SaveSnapshot(const std::string& path) const;
+
+    //maps a snapshot file written by SaveSnapshot; queries read postings, terms and texts
+    //straight from the mapped pages, they are copied only when the server is modified
+    static SearchServer LoadSnapshot(const std::string& path);
     
     void AddDocument(int document_id, std::string_view document, DocumentStatus status, const std::vector<int>& ratings);
 
+    //adds a batch of documents, tokenizing them and building their postings in parallel.
+    //If any document is invalid nothing is added and all the invalid documents are listed in the exception
+    template<typename ExecutionPolicy>
+    void AddDocuments(const ExecutionPolicy& policy, const std::vector<DocumentToAdd>& documents);
+
+    void AddDocuments(const std::vector<DocumentToAdd>& documents);
+
+    //describes every document of the batch which can't be added, returns an empty string if the whole batch is valid
+    template<typename ExecutionPolicy>
+    std::string CheckNewDocuments(const ExecutionPolicy& policy, const std::vector<DocumentToAdd>& documents) const;
+
+    //max_result_count limits the number of returned documents, MAX_RESULT_DOCUMENT_COUNT by default
+    template<typename Filter, typename ExecutionPolicy>
+    std::vector<Document> FindTopDocuments(const ExecutionPolicy& policy, std::string_view raw_query, Filter predicate, int max_result_count) const;
+
     template<typename Filter, typename ExecutionPolicy>
     std::vector<Document> FindTopDocuments(const ExecutionPolicy& policy, std::string_view raw_query, Filter predicate) const;
 
+    template<typename Filter>
+    std::vector<Document> FindTopDocuments(std::string_view raw_query, Filter predicate, int max_result_count) const;
+
     template<typename Filter>
     std::vector<Document> FindTopDocuments(std::string_view raw_query, Filter predicate) const;
 
     //to use with DocumentStatus
+    template<typename ExecutionPolicy>
+    std::vector<Document> FindTopDocuments(const ExecutionPolicy& policy, std::string_view raw_query, DocumentStatus status, int max_result_count) const;
+
     template<typename ExecutionPolicy>
     std::vector<Document> FindTopDocuments(const ExecutionPolicy& policy, std::string_view raw_query, DocumentStatus status) const;
 
@@ -53,14 +178,46 @@ public:
     template<typename ExecutionPolicy>
     std::vector<Document> FindTopDocuments(const ExecutionPolicy& policy, std::string_view raw_query) const;
 
+    std::vector<Document> FindTopDocuments(std::string_view raw_query, DocumentStatus status, int max_result_count) const;
+
     std::vector<Document> FindTopDocuments(std::string_view raw_query, DocumentStatus status) const;
 
     std::vector<Document> FindTopDocuments(std::string_view raw_query) const;
+
+    //finds the top documents of every query of the batch, the same as FindTopDocuments with the status.
+    //Every posting list used by the batch is decoded once for all the queries with its word
+    template<typename ExecutionPolicy>
+    std::vector<std::vector<Document>> FindTopDocumentsBatch(const ExecutionPolicy& policy, const std::vector<std::string>& raw_queries,
+        DocumentStatus status, int max_result_count) const;
+
+    template<typename ExecutionPolicy>
+    std::vector<std::vector<Document>> FindTopDocumentsBatch(const ExecutionPolicy& policy, const std::vector<std::string>& raw_queries) const;
+
+    //scores documents with IDF computed from stats instead of this server's own postings,
+    //stats must be collected with GetQueryStats for the same query
+    template<typename Filter, typename ExecutionPolicy>
+    std::vector<Document> FindTopDocuments(const ExecutionPolicy& policy, std::string_view raw_query, Filter predicate, int max_result_count,
+        const QueryStats& stats) const;
+
+    template<typename ExecutionPolicy>
+    std::vector<Document> FindTopDocuments(const ExecutionPolicy& policy, std::string_view raw_query, DocumentStatus status, int max_result_count,
+        const QueryStats& stats) const;
+
+    QueryStats GetQueryStats(std::string_view raw_query) const;
     
     using MatchDocumentResult = std::tuple<std::vector<std::string_view>, DocumentStatus>;
     MatchDocumentResult MatchDocument(const std::execution::sequenced_policy&, std::string_view raw_query, int document_id) const;
     MatchDocumentResult MatchDocument(std::string_view raw_query, int document_id) const;
     MatchDocumentResult MatchDocument(const std::execution::parallel_policy&, std::string_view raw_query, int document_id) const;
+    MatchDocumentResult MatchDocument(const ThreadPoolPolicy&, std::string_view raw_query, int document_id) const;
+
+    //same as MatchDocument for every id, the query is parsed once and intersected with the sorted terms
+    //of each document. Documents are matched in parallel; throws std::out_of_range for an unknown id
+    template<typename ExecutionPolicy>
+    std::vector<MatchDocumentResult> MatchDocuments(const ExecutionPolicy& policy, std::string_view raw_query,
+        const std::vector<int>& document_ids) const;
+
+    std::vector<MatchDocumentResult> MatchDocuments(std::string_view raw_query, const std::vector<int>& document_ids) const;
 
     int GetDocumentId(int index) const;
 
@@ -68,16 +225,22 @@ public:
 
     std::set<int>::const_iterator end() const;
 
-    const std::map<std::string_view, double>& GetWordFrequencies(int document_id) const;
+    std::map<std::string_view, double> GetWordFrequencies(int document_id) const;
 
+    //string_views from MatchDocument and GetWordFrequencies point to the term dictionary
+    //and are valid until the document they were returned for is removed
     void RemoveDocument(int document_id);
     void RemoveDocument(const std::execution::sequenced_policy& policy, int document_id);
     void RemoveDocument(const std::execution::parallel_policy& policy, int document_id);
+    void RemoveDocument(const ThreadPoolPolicy& policy, int document_id);
 private:
     //structs
     struct Query {
         std::vector<std::string_view> plus_words;
         std::vector<std::string_view> minus_words;
+        //ids of the words which are in the index, in the order of the words
+        std::vector<TermId> plus_terms;
+        std::vector<TermId> minus_terms;
     };
 
     struct QueryWord {
@@ -86,43 +249,177 @@ private:
         bool is_stop;
     };
 
+    struct WeightedPostings {
+        const PostingList* postings;
+        double inverse_document_freq;
+    };
+
+    //query of MatchDocuments, its terms are sorted by id like the terms of documents
+    struct MatchQuery {
+        //plus terms in the order of the words
+        std::vector<TermId> ordered_plus_terms;
+        //plus terms with their indexes in ordered_plus_terms
+        std::vector<std::pair<TermId, size_t>> plus_terms;
+        std::vector<TermId> minus_terms;
+    };
+
+    //query of a batch, its plus words are indexes of the batch terms in the order of the words
+    struct BatchQuery {
+        std::vector<size_t> plus_terms;
+        DocumentIdSet excluded_documents;
+    };
+
+    struct TermFreq {
+        TermId term;
+        double term_freq;
+    };
+
+    //rating and status are kept in columns, see document_ratings_
     struct DocumentData {
-        int rating;
-        DocumentStatus status;
-        std::map<std::string_view, double> word_count;
-        std::string text;
+        DocumentData() = default;
+        DocumentData(const DocumentData& other);
+        DocumentData(DocumentData&& other) noexcept;
+        DocumentData& operator=(const DocumentData& other);
+        DocumentData& operator=(DocumentData&& other) noexcept;
+
+        //sorted by term id
+        mutable std::vector<TermFreq> term_freqs;
+        //points into texts_, or into the mapped file for documents loaded from a snapshot,
+        //which build term_freqs from the snapshot words on first use
+        std::string_view text;
+        bool is_from_snapshot = false;
+        //reset once term_freqs is built, so readers of a built document don't lock anything
+        mutable std::atomic<const SnapshotWord*> snapshot_words = nullptr;
+        size_t snapshot_word_count = 0;
     };
 
+    struct LoadedSnapshot {
+        static constexpr size_t TERM_FREQS_MUTEX_COUNT = 64;
+
+        explicit LoadedSnapshot(const std::string& path);
+
+        MappedFile file;
+        size_t term_count = 0;
+        //documents are built under the mutex of their ordinal modulo the count
+        std::array<std::mutex, TERM_FREQS_MUTEX_COUNT> term_freqs_mutexes;
+    };
+
+    using WordPosting = std::pair<std::string_view, RawPosting>;
+
     //vars
-    std::set<std::string> stop_words_;
-    std::map<std::string_view, std::map<int, double>> word_to_document_freqs_;
-    std::map<int, DocumentData> documents_;
+    StopWordSet stop_words_;
+    //terms of a loaded snapshot get the ids of their indexes in the snapshot
+    TermDictionary terms_;
+    //postings of every term id, empty for unused ids. Deque elements don't move when it grows
+    std::deque<PostingList> term_postings_;
+    //documents are numbered by dense ordinals, which postings, document sets and scoring use instead of ids.
+    //Ordinals of removed documents are given to new documents
     std::set<int> document_ids_;
+    std::unordered_map<int, int> document_ordinals_;
+    std::vector<int> free_ordinals_;
+    //columns indexed by ordinal, the id of an unused ordinal is -1
+    std::vector<int> ordinal_document_ids_;
+    std::vector<int> document_ratings_;
+    std::vector<DocumentStatus> document_statuses_;
+    std::vector<DocumentData> documents_;
+    //ordinals of the documents of every status, so status queries skip other documents without looking them up
+    std::array<DocumentIdSet, DOCUMENT_STATUS_COUNT> status_documents_;
+    TextArena texts_;
+    std::shared_ptr<LoadedSnapshot> snapshot_;
+    uint64_t generation_ = 0;
     
     //methods
+    explicit SearchServer(std::shared_ptr<LoadedSnapshot> snapshot);
+
+    std::string DescribeInvalidDocuments(const std::vector<DocumentToAdd>& documents, const std::vector<char>& has_special_symbols) const;
+
+    //returns the ordinals of the documents
+    std::vector<int> InsertNewDocuments(const std::vector<DocumentToAdd>& documents);
+
+    int InsertDocument(int document_id, std::string_view text, DocumentStatus status, const std::vector<int>& ratings);
+
+    //throws std::out_of_range for an unknown id
+    int GetOrdinal(int document_id) const;
+
+    //same as CheckNewDocuments, also returns the words of the documents found by the same pass
+    template<typename ExecutionPolicy>
+    std::string SplitNewDocuments(const ExecutionPolicy& policy, const std::vector<DocumentToAdd>& documents,
+        std::vector<std::vector<std::string_view>>& document_words) const;
+
+    //postings of the document sorted by word
+    static std::vector<WordPosting> IndexDocumentWords(int ordinal, const std::vector<std::string_view>& words);
+
+    //term frequencies of the document with the given postings, all its words must be in the dictionary already
+    std::vector<TermFreq> GetTermFreqs(const std::vector<WordPosting>& postings) const;
+
+    const std::vector<TermFreq>& GetDocumentTermFreqs(const DocumentData& document) const;
+
+    TermId AddTerm(std::string_view word);
+
     bool IsStopWord(const std::string_view word) const;
     
-    std::vector<std::string_view> SplitIntoWordsNoStop(std::string_view text) const;
+    //returns false, leaving words incomplete, if the text has a special symbol
+    bool SplitIntoWordsNoStop(std::string_view text, std::vector<std::string_view>& words) const;
     
     QueryWord ParseQueryWord(std::string_view text) const;
     
     Query ParseQuery(std::string_view text, bool skip_sort = true) const;
     
-    double ComputeWordInverseDocumentFreq(std::string_view word) const;
+    double ComputeWordInverseDocumentFreq(const PostingList& postings) const;
 
-    template <typename Filter>
-    std::vector<Document> FindAllDocuments(const Query& query, Filter predicate) const;
+    //drops the term once no document has it
+    void ReleaseTerm(TermId term);
+
+    void EraseDocument(int ordinal);
+
+    void CompactTexts();
+
+    //shared by the parallel overloads, defined in search_server.cpp where they are instantiated
+    template<typename ExecutionPolicy>
+    MatchDocumentResult MatchDocumentInParallel(const ExecutionPolicy& policy, std::string_view raw_query, int document_id) const;
+
+    template<typename ExecutionPolicy>
+    void RemoveDocumentInParallel(const ExecutionPolicy& policy, int document_id);
+
+    MatchQuery ParseMatchQuery(std::string_view raw_query) const;
+
+    MatchDocumentResult MatchOrdinal(const MatchQuery& query, int ordinal) const;
+
+    //accepts every document, used when included_documents already does the filtering
+    struct AnyDocument {
+        bool operator()(int, DocumentStatus, int) const {
+            return true;
+        }
+    };
+
+    //returns nullptr for a status out of DocumentStatus, such documents are only found with a predicate
+    DocumentIdSet* GetStatusDocuments(DocumentStatus status);
+    const DocumentIdSet* GetStatusDocuments(DocumentStatus status) const;
+
+    //if included_documents is set, only documents with ordinals from it are scored
     template <typename ExecutionPolicy, typename Filter>
-    std::vector<Document> FindAllDocuments(const ExecutionPolicy& policy, const Query& query, Filter predicate) const;
+    std::vector<Document> FindAllDocuments(const ExecutionPolicy& policy, const Query& query, Filter predicate, size_t max_result_count,
+        const QueryStats* stats = nullptr, const DocumentIdSet* included_documents = nullptr) const;
 
-    bool StringHasSpecialSymbols(std::string_view s) const;
+    template <typename Filter>
+    void ScoreDocumentRange(int64_t first_ordinal, int64_t last_ordinal,
+        const std::vector<WeightedPostings>& plus_postings, const DocumentIdSet& excluded_documents,
+        const DocumentIdSet* included_documents, Filter predicate, TopDocuments& top_documents) const;
 
-    //static methods
-    template <typename ExecutionPolicy>
-    static void SortDocuments(const ExecutionPolicy& policy, std::vector<Document>& documents);
+    template <typename Filter>
+    void ScoreDocumentRangePruned(int64_t first_ordinal, int64_t last_ordinal,
+        const std::vector<WeightedPostings>& plus_postings, const DocumentIdSet& excluded_documents,
+        const DocumentIdSet* included_documents, Filter predicate, TopDocuments& top_documents) const;
+
+    //collects the distinct plus words of the queries into terms
+    std::vector<BatchQuery> ParseBatchQueries(const std::vector<std::string>& raw_queries, std::vector<WeightedPostings>& terms) const;
 
-    static void ApplyMaxResultDocumentCount(std::vector<Document>& docs);
+    void ScoreBatchRange(int64_t first_ordinal, int64_t last_ordinal, const std::vector<WeightedPostings>& terms,
+        const std::vector<BatchQuery>& queries, DocumentStatus status, std::vector<TopDocuments>& query_tops) const;
 
+    bool StringHasSpecialSymbols(std::string_view s) const;
+
+    //static methods
     static int ComputeAverageRating(const std::vector<int>& ratings);
 };
 
@@ -133,86 +430,471 @@ SearchServer::SearchServer(const C& container) {
         if (SearchServer::StringHasSpecialSymbols(word)) {
             throw std::invalid_argument("There is a special symbol in stopword: "s + std::string(word));
         }
-        stop_words_.insert(std::string(word));
+    }
+    stop_words_ = StopWordSet(stop_words);
+}
+
+template <typename Func>
+void SearchServer::TermPostings::ForEach(Func func) const {
+    server_->term_postings_[term_].ForEach([this, &func](const Posting& posting) {
+        func(server_->ordinal_document_ids_[posting.document_id], posting.term_freq);
+    });
+}
+
+template <typename Func>
+void SearchServer::ForEachTerm(Func func) const {
+    for (TermId term = 0; term < term_postings_.size(); ++term) {
+        if (!term_postings_[term].empty()) {
+            func(TermPostings(*this, term));
+        }
     }
 }
 
 template<typename ExecutionPolicy>
-void SearchServer::SortDocuments(const ExecutionPolicy& policy, std::vector<Document>& documents) {
-    sort(policy, documents.begin(), documents.end(),
-            [](const Document& lhs, const Document& rhs) {
-                if (std::abs(lhs.relevance - rhs.relevance) < RELEVANCE_THRESHOLD) {
-                    return lhs.rating > rhs.rating;
-                } else {
-                    return lhs.relevance > rhs.relevance;
-                }
-            });
+std::string SearchServer::CheckNewDocuments(const ExecutionPolicy& policy, const std::vector<DocumentToAdd>& documents) const {
+    std::vector<char> has_special_symbols(documents.size());
+    ParallelFor(policy, documents.size(), [&](size_t i) {
+        has_special_symbols[i] = StringHasSpecialSymbols(documents[i].text);
+    });
+    return DescribeInvalidDocuments(documents, has_special_symbols);
 }
 
-template<typename Filter>
-std::vector<Document> SearchServer::FindAllDocuments(const Query& query, Filter predicate) const {
-    return FindAllDocuments(std::execution::seq, query, predicate);
+template<typename ExecutionPolicy>
+std::string SearchServer::SplitNewDocuments(const ExecutionPolicy& policy, const std::vector<DocumentToAdd>& documents,
+    std::vector<std::vector<std::string_view>>& document_words) const {
+    document_words.assign(documents.size(), {});
+    std::vector<char> has_special_symbols(documents.size());
+    ParallelFor(policy, documents.size(), [&](size_t i) {
+        has_special_symbols[i] = !SplitIntoWordsNoStop(documents[i].text, document_words[i]);
+    });
+    return DescribeInvalidDocuments(documents, has_special_symbols);
 }
 
+template<typename ExecutionPolicy>
+void SearchServer::AddDocuments(const ExecutionPolicy& policy, const std::vector<DocumentToAdd>& documents) {
+    std::vector<std::vector<std::string_view>> document_words;
+    const std::string errors = SplitNewDocuments(policy, documents, document_words);
+    if (!errors.empty()) {
+        throw std::invalid_argument("Documents can't be added: "s + errors);
+    }
+
+    //words point to the caller's texts, which stay alive until the terms are added to the dictionary
+    const std::vector<int> ordinals = InsertNewDocuments(documents);
+    std::vector<std::vector<WordPosting>> document_postings(documents.size());
+    ParallelFor(policy, documents.size(), [&](size_t i) {
+        document_postings[i] = IndexDocumentWords(ordinals[i], document_words[i]);
+        std::vector<std::string_view>().swap(document_words[i]);
+    });
+
+    std::vector<WordPosting> postings;
+    for (const std::vector<WordPosting>& single_document_postings : document_postings) {
+        postings.insert(postings.end(), single_document_postings.begin(), single_document_postings.end());
+    }
+    ParallelSort(policy, postings.begin(), postings.end(), [](const WordPosting& lhs, const WordPosting& rhs) {
+        return lhs.first < rhs.first || (lhs.first == rhs.first && lhs.second.document_id < rhs.second.document_id);
+    });
+
+    //one dictionary lookup per distinct word, then the posting lists of different words are filled in parallel
+    struct WordPostings {
+        PostingList* postings;
+        size_t begin;
+        size_t end;
+    };
+    std::vector<WordPostings> words;
+    for (size_t begin = 0, end = 0; begin < postings.size(); begin = end) {
+        for (end = begin + 1; end < postings.size() && postings[end].first == postings[begin].first; ++end) {
+        }
+        words.push_back({&term_postings_[AddTerm(postings[begin].first)], begin, end});
+    }
+    ParallelFor(policy, words.size(), [&](size_t i) {
+        const WordPostings& word = words[i];
+        std::vector<RawPosting> word_postings;
+        word_postings.reserve(word.end - word.begin);
+        for (size_t posting_index = word.begin; posting_index < word.end; ++posting_index) {
+            word_postings.push_back(postings[posting_index].second);
+        }
+        word.postings->Add(word_postings);
+    });
+    ParallelFor(policy, documents.size(), [&](size_t i) {
+        documents_[ordinals[i]].term_freqs = GetTermFreqs(document_postings[i]);
+        std::vector<WordPosting>().swap(document_postings[i]);
+    });
+    ++generation_;
+}
+
+//finds all documents matching the query and keeps the best max_result_count of them.
+//Every worker scores its own slice of the document id range, so no state is shared between workers
 template<typename ExecutionPolicy, typename Filter>
-std::vector<Document> SearchServer::FindAllDocuments(const ExecutionPolicy& policy, const Query& query, Filter predicate) const {
-    ConcurrentMap<int, double> document_to_relevance(document_ids_.size());
-
-    std::for_each(policy, query.plus_words.begin(), query.plus_words.end(), [&](std::string_view word) {
-        if (word_to_document_freqs_.count(word) > 0) {
-            const double inverse_document_freq = ComputeWordInverseDocumentFreq(word);
-            for (const auto [document_id, term_freq] : word_to_document_freqs_.at(word)) {
-                const auto& doc_info = documents_.at(document_id);
-                if (predicate(document_id, doc_info.status, doc_info.rating)) {
-                    document_to_relevance[document_id].ref_to_value += term_freq * inverse_document_freq;
+std::vector<Document> SearchServer::FindAllDocuments(const ExecutionPolicy& policy, const Query& query, Filter predicate, size_t max_result_count,
+    const QueryStats* stats, const DocumentIdSet* included_documents) const {
+    std::vector<WeightedPostings> plus_postings;
+    for (const TermId term : query.plus_terms) {
+        const PostingList& postings = term_postings_[term];
+        if (stats == nullptr) {
+            plus_postings.push_back({&postings, ComputeWordInverseDocumentFreq(postings)});
+            continue;
+        }
+        const std::string_view word = terms_.GetText(term);
+        const auto stats_it = stats->document_freqs.find(word);
+        if (stats_it == stats->document_freqs.end()) {
+            throw std::invalid_argument("There are no query stats for word: "s + std::string(word));
+        }
+        plus_postings.push_back({&postings, ComputeInverseDocumentFreq(stats->document_count, stats_it->second)});
+    }
+    if (plus_postings.empty() || max_result_count == 0 || (included_documents != nullptr && included_documents->empty())) {
+        return {};
+    }
+    //documents with minus words are collected once and skipped by every worker before scoring
+    std::vector<int> excluded_ids;
+    for (const TermId term : query.minus_terms) {
+        term_postings_[term].ForEach([&excluded_ids](const Posting& posting) {
+            excluded_ids.push_back(posting.document_id);
+        });
+    }
+    const DocumentIdSet excluded_documents(std::move(excluded_ids));
+
+    const int64_t ordinal_count = ordinal_document_ids_.size();
+    const size_t range_count = std::min<int64_t>(GetParallelism(policy), (ordinal_count + SCORING_WINDOW_SIZE - 1) / SCORING_WINDOW_SIZE);
+
+    //score bounds are useless for single word queries and for long results, where the top fills late
+    const bool use_pruning = plus_postings.size() > 1 && max_result_count <= MAX_PRUNED_RESULT_COUNT
+        && std::all_of(plus_postings.begin(), plus_postings.end(), [](const WeightedPostings& weighted_postings) {
+            return weighted_postings.inverse_document_freq >= 0.0;
+        });
+
+    std::vector<TopDocuments> range_tops(range_count, TopDocuments(max_result_count));
+    ParallelFor(policy, range_count, [&](size_t i) {
+        const int64_t range_begin = ordinal_count * i / range_count;
+        const int64_t range_end = ordinal_count * (i + 1) / range_count;
+        if (use_pruning) {
+            ScoreDocumentRangePruned(range_begin, range_end, plus_postings, excluded_documents, included_documents, predicate, range_tops[i]);
+        } else {
+            ScoreDocumentRange(range_begin, range_end, plus_postings, excluded_documents, included_documents, predicate, range_tops[i]);
+        }
+    });
+
+    for (size_t i = 1; i < range_count; ++i) {
+        range_tops[0].Merge(std::move(range_tops[i]));
+    }
+    return range_tops[0].Extract();
+}
+
+template <typename Filter>
+void SearchServer::ScoreDocumentRange(int64_t first_ordinal, int64_t last_ordinal,
+    const std::vector<WeightedPostings>& plus_postings, const DocumentIdSet& excluded_documents,
+    const DocumentIdSet* included_documents, Filter predicate, TopDocuments& top_documents) const {
+    std::vector<PostingList::Cursor> plus_cursors;
+    plus_cursors.reserve(plus_postings.size());
+    for (const WeightedPostings& weighted_postings : plus_postings) {
+        plus_cursors.push_back(weighted_postings.postings->GetCursor());
+        plus_cursors.back().SkipTo(first_ordinal);
+    }
+
+    std::vector<double> relevance(SCORING_WINDOW_SIZE);
+    std::vector<char> is_matched(SCORING_WINDOW_SIZE, 0);
+    std::vector<char> is_excluded(SCORING_WINDOW_SIZE, 0);
+    std::vector<int> matched_offsets;
+    matched_offsets.reserve(SCORING_WINDOW_SIZE);
+
+    while (true) {
+        int64_t window_begin = last_ordinal;
+        for (const PostingList::Cursor& cursor : plus_cursors) {
+            if (!cursor.AtEnd()) {
+                window_begin = std::min<int64_t>(window_begin, cursor.NextDocumentId());
+            }
+        }
+        if (window_begin >= last_ordinal) {
+            break;
+        }
+        const int64_t window_end = std::min(last_ordinal, window_begin + SCORING_WINDOW_SIZE);
+        excluded_documents.ForEachInRange(window_begin, window_end, [&](int ordinal) {
+            is_excluded[ordinal - window_begin] = 1;
+        });
+
+        for (size_t i = 0; i < plus_cursors.size(); ++i) {
+            const double inverse_document_freq = plus_postings[i].inverse_document_freq;
+            plus_cursors[i].ForEachBefore(window_end, [&](const Posting& posting) {
+                const int offset = posting.document_id - window_begin;
+                if (is_excluded[offset]) {
+                    return;
+                }
+                if (!is_matched[offset]) {
+                    is_matched[offset] = 1;
+                    relevance[offset] = 0.0;
+                    matched_offsets.push_back(offset);
                 }
+                relevance[offset] += posting.term_freq * inverse_document_freq;
+            });
+        }
+        excluded_documents.ForEachInRange(window_begin, window_end, [&](int ordinal) {
+            is_excluded[ordinal - window_begin] = 0;
+        });
+
+        for (int offset : matched_offsets) {
+            is_matched[offset] = 0;
+            //a document which can't get into the top is dropped before its metadata is looked up
+            if (relevance[offset] < top_documents.GetMinRelevance() - 2 * RELEVANCE_THRESHOLD) {
+                continue;
+            }
+            const int ordinal = window_begin + offset;
+            //looked up per matched document, so a rare word doesn't pay for the whole window of the set
+            if (included_documents != nullptr && !included_documents->Contains(ordinal)) {
+                continue;
+            }
+            const int document_id = ordinal_document_ids_[ordinal];
+            const int rating = document_ratings_[ordinal];
+            const DocumentStatus status = document_statuses_[ordinal];
+            if (predicate(document_id, status, rating)) {
+                top_documents.Push(Document(document_id, relevance[offset], rating, status));
             }
         }
+        matched_offsets.clear();
+    }
+}
+
+//document-at-a-time MaxScore evaluation. Words are ordered by the bound of their score; the words whose
+//bounds together can't lift a document into the current top don't produce candidates, they are only looked up
+//for candidates found through the other words, and a candidate is dropped as soon as its bound falls below the top.
+//Bounds are compared with a margin of two RELEVANCE_THRESHOLD, so no document which could be kept is dropped,
+//and relevance is summed in query word order, as in ScoreDocumentRange, so the results are the same
+template <typename Filter>
+void SearchServer::ScoreDocumentRangePruned(int64_t first_ordinal, int64_t last_ordinal,
+    const std::vector<WeightedPostings>& plus_postings, const DocumentIdSet& excluded_documents,
+    const DocumentIdSet* included_documents, Filter predicate, TopDocuments& top_documents) const {
+    const size_t word_count = plus_postings.size();
+    std::vector<PostingList::Cursor> plus_cursors;
+    plus_cursors.reserve(word_count);
+    std::vector<double> max_scores(word_count);
+    for (size_t i = 0; i < word_count; ++i) {
+        plus_cursors.push_back(plus_postings[i].postings->GetCursor());
+        plus_cursors.back().SkipTo(first_ordinal);
+        max_scores[i] = plus_postings[i].postings->GetMaxTermFreq() * plus_postings[i].inverse_document_freq;
+    }
+
+    std::vector<size_t> order(word_count);
+    std::iota(order.begin(), order.end(), 0);
+    std::sort(order.begin(), order.end(), [&max_scores](size_t lhs, size_t rhs) {
+        return max_scores[lhs] < max_scores[rhs];
     });
+    std::vector<double> max_score_prefix_sums(word_count);
+    for (size_t k = 0; k < word_count; ++k) {
+        max_score_prefix_sums[k] = (k == 0 ? 0.0 : max_score_prefix_sums[k - 1]) + max_scores[order[k]];
+    }
+
+    //words order[0..first_essential) are looked up only for candidates
+    size_t first_essential = 0;
+    double min_score = -std::numeric_limits<double>::infinity();
+    const auto update_min_score = [&]() {
+        min_score = top_documents.GetMinRelevance() - 2 * RELEVANCE_THRESHOLD;
+        while (first_essential < word_count && max_score_prefix_sums[first_essential] < min_score) {
+            ++first_essential;
+        }
+    };
+
+    std::vector<double> scores(word_count);
+    std::vector<char> has_word(word_count);
+    std::vector<double> score_bounds(word_count);
+    while (first_essential < word_count) {
+        int64_t ordinal = last_ordinal;
+        for (size_t k = first_essential; k < word_count; ++k) {
+            if (!plus_cursors[order[k]].AtEnd()) {
+                ordinal = std::min<int64_t>(ordinal, plus_cursors[order[k]].NextDocumentId());
+            }
+        }
+        if (ordinal >= last_ordinal) {
+            break;
+        }
+        if (excluded_documents.Contains(ordinal)
+            || (included_documents != nullptr && !included_documents->Contains(ordinal))) {
+            for (size_t k = first_essential; k < word_count; ++k) {
+                PostingList::Cursor& cursor = plus_cursors[order[k]];
+                if (!cursor.AtEnd() && cursor.NextDocumentId() == ordinal) {
+                    cursor.Next();
+                }
+            }
+            continue;
+        }
 
-    std::map<int, double> document_map = document_to_relevance.BuildOrdinaryMap();
+        std::fill(has_word.begin(), has_word.end(), 0);
+        double score = 0.0;
+        for (size_t k = first_essential; k < word_count; ++k) {
+            const size_t i = order[k];
+            if (!plus_cursors[i].AtEnd() && plus_cursors[i].NextDocumentId() == ordinal) {
+                scores[i] = plus_cursors[i].Next().term_freq * plus_postings[i].inverse_document_freq;
+                has_word[i] = 1;
+                score += scores[i];
+            }
+        }
+        double rest_bound = 0.0;
+        for (size_t k = 0; k < first_essential; ++k) {
+            const size_t i = order[k];
+            score_bounds[k] = plus_cursors[i].GetTermFreqBound(ordinal) * plus_postings[i].inverse_document_freq;
+            rest_bound += score_bounds[k];
+        }
+        bool is_pruned = score + rest_bound < min_score;
+        for (size_t k = first_essential; k-- > 0 && !is_pruned;) {
+            const size_t i = order[k];
+            rest_bound -= score_bounds[k];
+            if (score_bounds[k] > 0.0) {
+                plus_cursors[i].SkipTo(ordinal);
+                if (!plus_cursors[i].AtEnd() && plus_cursors[i].NextDocumentId() == ordinal) {
+                    scores[i] = plus_cursors[i].Next().term_freq * plus_postings[i].inverse_document_freq;
+                    has_word[i] = 1;
+                    score += scores[i];
+                }
+            }
+            is_pruned = score + rest_bound < min_score;
+        }
+        if (is_pruned) {
+            continue;
+        }
 
-    std::for_each(policy, query.minus_words.begin(), query.minus_words.end(), [&](std::string_view word){
-        if (word_to_document_freqs_.count(word) > 0) {
-            for (const auto [document_id, _] : word_to_document_freqs_.at(word)) {
-                document_map.erase(document_id);
+        double relevance = 0.0;
+        for (size_t i = 0; i < word_count; ++i) {
+            if (has_word[i]) {
+                relevance += scores[i];
             }
         }
+        if (relevance < min_score) {
+            continue;
+        }
+        const int document_id = ordinal_document_ids_[ordinal];
+        const int rating = document_ratings_[ordinal];
+        const DocumentStatus status = document_statuses_[ordinal];
+        if (!predicate(document_id, status, rating)) {
+            continue;
+        }
+        top_documents.Push(Document(document_id, relevance, rating, status));
+        update_min_score();
+    }
+}
+
+template<typename ExecutionPolicy>
+std::vector<SearchServer::MatchDocumentResult> SearchServer::MatchDocuments(const ExecutionPolicy& policy, std::string_view raw_query,
+    const std::vector<int>& document_ids) const {
+    const MatchQuery query = ParseMatchQuery(raw_query);
+    std::vector<int> ordinals;
+    ordinals.reserve(document_ids.size());
+    for (const int document_id : document_ids) {
+        ordinals.push_back(GetOrdinal(document_id));
+    }
+    std::vector<MatchDocumentResult> results(ordinals.size());
+    ParallelFor(policy, ordinals.size(), [&](size_t i) {
+        results[i] = MatchOrdinal(query, ordinals[i]);
     });
-    
-    std::vector<Document> matched_documents(document_map.size());
-    
-    std::transform(document_map.begin(), document_map.end(), matched_documents.begin(), [&](const auto& it) {
-        auto& i = documents_.at(it.first);
-        return Document(it.first, it.second, i.rating, i.status);
+    return results;
+}
+
+template<typename ExecutionPolicy>
+std::vector<std::vector<Document>> SearchServer::FindTopDocumentsBatch(const ExecutionPolicy& policy, const std::vector<std::string>& raw_queries,
+    DocumentStatus status, int max_result_count) const {
+    if (max_result_count < 0) {
+        throw std::invalid_argument("Max result document count("s + std::to_string(max_result_count) + ") is less then 0"s);
+    }
+    std::vector<WeightedPostings> terms;
+    const std::vector<BatchQuery> queries = ParseBatchQueries(raw_queries, terms);
+    std::vector<std::vector<Document>> results(queries.size());
+    const DocumentIdSet* status_documents = GetStatusDocuments(status);
+    if (terms.empty() || max_result_count == 0 || (status_documents != nullptr && status_documents->empty())) {
+        return results;
+    }
+
+    //like FindAllDocuments, every worker scores its own slice of the ordinals, for all the queries at once
+    const int64_t ordinal_count = ordinal_document_ids_.size();
+    const size_t range_count = std::min<int64_t>(GetParallelism(policy), (ordinal_count + SCORING_WINDOW_SIZE - 1) / SCORING_WINDOW_SIZE);
+    std::vector<std::vector<TopDocuments>> range_tops(range_count, std::vector<TopDocuments>(queries.size(), TopDocuments(max_result_count)));
+    ParallelFor(policy, range_count, [&](size_t i) {
+        const int64_t range_begin = ordinal_count * i / range_count;
+        const int64_t range_end = ordinal_count * (i + 1) / range_count;
+        ScoreBatchRange(range_begin, range_end, terms, queries, status, range_tops[i]);
     });
 
-    return matched_documents;
+    for (size_t q = 0; q < queries.size() && range_count > 0; ++q) {
+        for (size_t i = 1; i < range_count; ++i) {
+            range_tops[0][q].Merge(std::move(range_tops[i][q]));
+        }
+        results[q] = range_tops[0][q].Extract();
+    }
+    return results;
+}
+
+template<typename ExecutionPolicy>
+std::vector<std::vector<Document>> SearchServer::FindTopDocumentsBatch(const ExecutionPolicy& policy, const std::vector<std::string>& raw_queries) const {
+    return FindTopDocumentsBatch(policy, raw_queries, DocumentStatus::ACTUAL, MAX_RESULT_DOCUMENT_COUNT);
 }
 
 //to use with filter lambda
 
+template<typename Filter>
+std::vector<Document> SearchServer::FindTopDocuments(std::string_view raw_query, Filter predicate, int max_result_count) const {
+    return FindTopDocuments(std::execution::seq, raw_query, predicate, max_result_count);
+}
+
 template<typename Filter>
 std::vector<Document> SearchServer::FindTopDocuments(std::string_view raw_query, Filter predicate) const {            
     return FindTopDocuments(std::execution::seq, raw_query, predicate);
 }
 
+template<typename Filter, typename ExecutionPolicy>
+std::vector<Document> SearchServer::FindTopDocuments(const ExecutionPolicy& policy, std::string_view raw_query, Filter predicate, int max_result_count) const {
+    if (max_result_count < 0) {
+        throw std::invalid_argument("Max result document count("s + std::to_string(max_result_count) + ") is less then 0"s);
+    }
+    const Query query = ParseQuery(raw_query, false);
+    return FindAllDocuments(policy, query, predicate, max_result_count);
+}
+
+template<typename Filter, typename ExecutionPolicy>
+std::vector<Document> SearchServer::FindTopDocuments(const ExecutionPolicy& policy, std::string_view raw_query, Filter predicate, int max_result_count,
+    const QueryStats& stats) const {
+    if (max_result_count < 0) {
+        throw std::invalid_argument("Max result document count("s + std::to_string(max_result_count) + ") is less then 0"s);
+    }
+    const Query query = ParseQuery(raw_query, false);
+    return FindAllDocuments(policy, query, predicate, max_result_count, &stats);
+}
+
 template<typename Filter, typename ExecutionPolicy>
 std::vector<Document> SearchServer::FindTopDocuments(const ExecutionPolicy& policy, std::string_view raw_query, Filter predicate) const {            
+    return FindTopDocuments(policy, raw_query, predicate, MAX_RESULT_DOCUMENT_COUNT);
+}
+
+//status queries score only the documents of that status instead of checking every matched document
+
+template<typename ExecutionPolicy>
+std::vector<Document> SearchServer::FindTopDocuments(const ExecutionPolicy& policy, std::string_view raw_query, DocumentStatus status, int max_result_count) const {
+    if (max_result_count < 0) {
+        throw std::invalid_argument("Max result document count("s + std::to_string(max_result_count) + ") is less then 0"s);
+    }
     const Query query = ParseQuery(raw_query, false);
-    std::vector<Document> matched_documents = FindAllDocuments(policy, query, predicate);
-    SortDocuments(policy, matched_documents);
-    ApplyMaxResultDocumentCount(matched_documents);
-    return matched_documents;
+    if (const DocumentIdSet* status_documents = GetStatusDocuments(status)) {
+        return FindAllDocuments(policy, query, AnyDocument{}, max_result_count, nullptr, status_documents);
+    }
+    return FindAllDocuments(policy, query, [status](int document_id, DocumentStatus document_status, int rating) {
+            return document_status == status;
+        },
+        max_result_count, nullptr);
+}
+
+template<typename ExecutionPolicy>
+std::vector<Document> SearchServer::FindTopDocuments(const ExecutionPolicy& policy, std::string_view raw_query, DocumentStatus status, int max_result_count,
+    const QueryStats& stats) const {
+    if (max_result_count < 0) {
+        throw std::invalid_argument("Max result document count("s + std::to_string(max_result_count) + ") is less then 0"s);
+    }
+    const Query query = ParseQuery(raw_query, false);
+    if (const DocumentIdSet* status_documents = GetStatusDocuments(status)) {
+        return FindAllDocuments(policy, query, AnyDocument{}, max_result_count, &stats, status_documents);
+    }
+    return FindAllDocuments(policy, query, [status](int document_id, DocumentStatus document_status, int rating) {
+            return document_status == status;
+        },
+        max_result_count, &stats);
 }
 
 template<typename ExecutionPolicy>
 std::vector<Document> SearchServer::FindTopDocuments(const ExecutionPolicy& policy, std::string_view raw_query, DocumentStatus status) const {
-    return SearchServer::FindTopDocuments(policy, raw_query, [status](int doc_id, DocumentStatus doc_status, int doc_rating) 
-        {
-            return doc_status == status;
-        }
-    );
+    return SearchServer::FindTopDocuments(policy, raw_query, status, MAX_RESULT_DOCUMENT_COUNT);
 }
 
 template<typename ExecutionPolicy>
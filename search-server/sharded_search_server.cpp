@@ -0,0 +1,97 @@
+#include <cstdint>
+
+#include "sharded_search_server.h"
+
+using namespace std::string_literals;
+
+ShardedSearchServer::ShardedSearchServer(size_t shard_count) {
+    CheckShardCount(shard_count);
+    shards_.resize(shard_count);
+}
+
+size_t ShardedSearchServer::GetShardCount() const {
+    return shards_.size();
+}
+
+const SearchServer& ShardedSearchServer::GetShard(size_t index) const {
+    return shards_.at(index);
+}
+
+// Fibonacci hashing spreads runs of consecutive ids evenly between the shards
+size_t ShardedSearchServer::GetShardIndex(int document_id) const {
+    const uint64_t hash = static_cast<uint64_t>(static_cast<uint32_t>(document_id)) * 0x9E3779B97F4A7C15ull;
+    return (hash >> 32) % shards_.size();
+}
+
+int ShardedSearchServer::GetDocumentCount() const {
+    int document_count = 0;
+    for (const SearchServer& shard : shards_) {
+        document_count += shard.GetDocumentCount();
+    }
+    return document_count;
+}
+
+void ShardedSearchServer::AddDocument(int document_id, std::string_view document, DocumentStatus status, const std::vector<int>& ratings) {
+    shards_[GetShardIndex(document_id)].AddDocument(document_id, document, status, ratings);
+}
+
+void ShardedSearchServer::AddDocuments(const std::vector<DocumentToAdd>& documents) {
+    AddDocuments(std::execution::seq, documents);
+}
+
+std::vector<Document> ShardedSearchServer::FindTopDocuments(std::string_view raw_query, DocumentStatus status, int max_result_count) const {
+    return FindTopDocuments(std::execution::seq, raw_query, status, max_result_count);
+}
+
+std::vector<Document> ShardedSearchServer::FindTopDocuments(std::string_view raw_query, DocumentStatus status) const {
+    return FindTopDocuments(std::execution::seq, raw_query, status);
+}
+
+std::vector<Document> ShardedSearchServer::FindTopDocuments(std::string_view raw_query) const {
+    return FindTopDocuments(std::execution::seq, raw_query);
+}
+
+SearchServer::MatchDocumentResult ShardedSearchServer::MatchDocument(
+    const std::execution::sequenced_policy& policy, std::string_view raw_query, int document_id) const {
+    return shards_[GetShardIndex(document_id)].MatchDocument(policy, raw_query, document_id);
+}
+
+SearchServer::MatchDocumentResult ShardedSearchServer::MatchDocument(std::string_view raw_query, int document_id) const {
+    return MatchDocument(std::execution::seq, raw_query, document_id);
+}
+
+SearchServer::MatchDocumentResult ShardedSearchServer::MatchDocument(
+    const std::execution::parallel_policy& policy, std::string_view raw_query, int document_id) const {
+    return shards_[GetShardIndex(document_id)].MatchDocument(policy, raw_query, document_id);
+}
+
+SearchServer::MatchDocumentResult ShardedSearchServer::MatchDocument(
+    const ThreadPoolPolicy& policy, std::string_view raw_query, int document_id) const {
+    return shards_[GetShardIndex(document_id)].MatchDocument(policy, raw_query, document_id);
+}
+
+std::map<std::string_view, double> ShardedSearchServer::GetWordFrequencies(int document_id) const {
+    return shards_[GetShardIndex(document_id)].GetWordFrequencies(document_id);
+}
+
+void ShardedSearchServer::RemoveDocument(int document_id) {
+    shards_[GetShardIndex(document_id)].RemoveDocument(document_id);
+}
+
+void ShardedSearchServer::RemoveDocument(const std::execution::sequenced_policy& policy, int document_id) {
+    shards_[GetShardIndex(document_id)].RemoveDocument(policy, document_id);
+}
+
+void ShardedSearchServer::RemoveDocument(const std::execution::parallel_policy& policy, int document_id) {
+    shards_[GetShardIndex(document_id)].RemoveDocument(policy, document_id);
+}
+
+void ShardedSearchServer::RemoveDocument(const ThreadPoolPolicy& policy, int document_id) {
+    shards_[GetShardIndex(document_id)].RemoveDocument(policy, document_id);
+}
+
+void ShardedSearchServer::CheckShardCount(size_t shard_count) {
+    if (shard_count == 0) {
+        throw std::invalid_argument("Shard count must be positive"s);
+    }
+}
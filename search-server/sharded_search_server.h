@@ -0,0 +1,195 @@
+#pragma once
+
+#include <vector>
+#include <string>
+#include <string_view>
+#include <map>
+#include <stdexcept>
+#include <execution>
+#include <algorithm>
+#include <numeric>
+
+#include "search_server.h"
+#include "top_documents.h"
+#include "thread_pool.h"
+
+// Splits documents between independent SearchServer shards by a hash of the document id.
+// Queries are sent to every shard and their results are merged; documents are scored with
+// the document frequencies of the whole collection, so relevance is the same as in a single server
+class ShardedSearchServer {
+public:
+    template<typename StopWords>
+    ShardedSearchServer(size_t shard_count, const StopWords& stop_words);
+
+    explicit ShardedSearchServer(size_t shard_count);
+
+    size_t GetShardCount() const;
+
+    const SearchServer& GetShard(size_t index) const;
+
+    size_t GetShardIndex(int document_id) const;
+
+    int GetDocumentCount() const;
+
+    void AddDocument(int document_id, std::string_view document, DocumentStatus status, const std::vector<int>& ratings);
+
+    //batches are split between the shards, which add their parts in parallel
+    template<typename ExecutionPolicy>
+    void AddDocuments(const ExecutionPolicy& policy, const std::vector<DocumentToAdd>& documents);
+
+    void AddDocuments(const std::vector<DocumentToAdd>& documents);
+
+    //the policy is used to query the shards, every shard scores its documents sequentially
+    template<typename Filter, typename ExecutionPolicy>
+    std::vector<Document> FindTopDocuments(const ExecutionPolicy& policy, std::string_view raw_query, Filter predicate, int max_result_count) const;
+
+    template<typename Filter, typename ExecutionPolicy>
+    std::vector<Document> FindTopDocuments(const ExecutionPolicy& policy, std::string_view raw_query, Filter predicate) const;
+
+    template<typename Filter>
+    std::vector<Document> FindTopDocuments(std::string_view raw_query, Filter predicate, int max_result_count) const;
+
+    template<typename Filter>
+    std::vector<Document> FindTopDocuments(std::string_view raw_query, Filter predicate) const;
+
+    template<typename ExecutionPolicy>
+    std::vector<Document> FindTopDocuments(const ExecutionPolicy& policy, std::string_view raw_query, DocumentStatus status, int max_result_count) const;
+
+    template<typename ExecutionPolicy>
+    std::vector<Document> FindTopDocuments(const ExecutionPolicy& policy, std::string_view raw_query, DocumentStatus status) const;
+
+    template<typename ExecutionPolicy>
+    std::vector<Document> FindTopDocuments(const ExecutionPolicy& policy, std::string_view raw_query) const;
+
+    std::vector<Document> FindTopDocuments(std::string_view raw_query, DocumentStatus status, int max_result_count) const;
+
+    std::vector<Document> FindTopDocuments(std::string_view raw_query, DocumentStatus status) const;
+
+    std::vector<Document> FindTopDocuments(std::string_view raw_query) const;
+
+    SearchServer::MatchDocumentResult MatchDocument(const std::execution::sequenced_policy& policy, std::string_view raw_query, int document_id) const;
+    SearchServer::MatchDocumentResult MatchDocument(std::string_view raw_query, int document_id) const;
+    SearchServer::MatchDocumentResult MatchDocument(const std::execution::parallel_policy& policy, std::string_view raw_query, int document_id) const;
+    SearchServer::MatchDocumentResult MatchDocument(const ThreadPoolPolicy& policy, std::string_view raw_query, int document_id) const;
+
+    std::map<std::string_view, double> GetWordFrequencies(int document_id) const;
+
+    void RemoveDocument(int document_id);
+    void RemoveDocument(const std::execution::sequenced_policy& policy, int document_id);
+    void RemoveDocument(const std::execution::parallel_policy& policy, int document_id);
+    void RemoveDocument(const ThreadPoolPolicy& policy, int document_id);
+
+private:
+    std::vector<SearchServer> shards_;
+
+    template<typename ExecutionPolicy>
+    QueryStats GetQueryStats(const ExecutionPolicy& policy, std::string_view raw_query) const;
+
+    //filter is a predicate or a DocumentStatus, it is passed to the shards as is
+    template<typename Filter, typename ExecutionPolicy>
+    std::vector<Document> FindTopDocumentsInShards(const ExecutionPolicy& policy, std::string_view raw_query, const Filter& filter, int max_result_count) const;
+
+    static void CheckShardCount(size_t shard_count);
+};
+
+template<typename StopWords>
+ShardedSearchServer::ShardedSearchServer(size_t shard_count, const StopWords& stop_words) {
+    CheckShardCount(shard_count);
+    shards_.reserve(shard_count);
+    for (size_t i = 0; i < shard_count; ++i) {
+        shards_.emplace_back(stop_words);
+    }
+}
+
+template<typename ExecutionPolicy>
+void ShardedSearchServer::AddDocuments(const ExecutionPolicy& policy, const std::vector<DocumentToAdd>& documents) {
+    std::vector<std::vector<DocumentToAdd>> shard_documents(shards_.size());
+    for (const DocumentToAdd& document : documents) {
+        shard_documents[GetShardIndex(document.id)].push_back(document);
+    }
+    //all parts are checked before any shard adds its documents, so an invalid batch changes nothing
+    std::vector<std::string> shard_errors(shards_.size());
+    ParallelFor(policy, shards_.size(), [&](size_t i) {
+        shard_errors[i] = shards_[i].CheckNewDocuments(std::execution::seq, shard_documents[i]);
+    });
+    std::string errors;
+    for (const std::string& shard_error : shard_errors) {
+        if (!shard_error.empty()) {
+            errors += (errors.empty() ? ""s : "; "s) + shard_error;
+        }
+    }
+    if (!errors.empty()) {
+        throw std::invalid_argument("Documents can't be added: "s + errors);
+    }
+
+    ParallelFor(policy, shards_.size(), [&](size_t i) {
+        shards_[i].AddDocuments(std::execution::seq, shard_documents[i]);
+    });
+}
+
+template<typename ExecutionPolicy>
+QueryStats ShardedSearchServer::GetQueryStats(const ExecutionPolicy& policy, std::string_view raw_query) const {
+    std::vector<QueryStats> shard_stats(shards_.size());
+    ParallelFor(policy, shards_.size(), [&](size_t i) {
+        shard_stats[i] = shards_[i].GetQueryStats(raw_query);
+    });
+    for (size_t i = 1; i < shard_stats.size(); ++i) {
+        shard_stats[0].Merge(shard_stats[i]);
+    }
+    return shard_stats[0];
+}
+
+template<typename Filter, typename ExecutionPolicy>
+std::vector<Document> ShardedSearchServer::FindTopDocuments(const ExecutionPolicy& policy, std::string_view raw_query, Filter predicate, int max_result_count) const {
+    return FindTopDocumentsInShards(policy, raw_query, predicate, max_result_count);
+}
+
+template<typename Filter, typename ExecutionPolicy>
+std::vector<Document> ShardedSearchServer::FindTopDocumentsInShards(const ExecutionPolicy& policy, std::string_view raw_query, const Filter& filter,
+    int max_result_count) const {
+    if (max_result_count < 0) {
+        throw std::invalid_argument("Max result document count("s + std::to_string(max_result_count) + ") is less then 0"s);
+    }
+    const QueryStats stats = GetQueryStats(policy, raw_query);
+    std::vector<std::vector<Document>> shard_documents(shards_.size());
+    ParallelFor(policy, shards_.size(), [&](size_t i) {
+        shard_documents[i] = shards_[i].FindTopDocuments(std::execution::seq, raw_query, filter, max_result_count, stats);
+    });
+    TopDocuments top_documents(max_result_count);
+    for (const std::vector<Document>& documents : shard_documents) {
+        for (const Document& document : documents) {
+            top_documents.Push(document);
+        }
+    }
+    return top_documents.Extract();
+}
+
+template<typename Filter, typename ExecutionPolicy>
+std::vector<Document> ShardedSearchServer::FindTopDocuments(const ExecutionPolicy& policy, std::string_view raw_query, Filter predicate) const {
+    return FindTopDocuments(policy, raw_query, predicate, MAX_RESULT_DOCUMENT_COUNT);
+}
+
+template<typename Filter>
+std::vector<Document> ShardedSearchServer::FindTopDocuments(std::string_view raw_query, Filter predicate, int max_result_count) const {
+    return FindTopDocuments(std::execution::seq, raw_query, predicate, max_result_count);
+}
+
+template<typename Filter>
+std::vector<Document> ShardedSearchServer::FindTopDocuments(std::string_view raw_query, Filter predicate) const {
+    return FindTopDocuments(std::execution::seq, raw_query, predicate);
+}
+
+template<typename ExecutionPolicy>
+std::vector<Document> ShardedSearchServer::FindTopDocuments(const ExecutionPolicy& policy, std::string_view raw_query, DocumentStatus status, int max_result_count) const {
+    return FindTopDocumentsInShards(policy, raw_query, status, max_result_count);
+}
+
+template<typename ExecutionPolicy>
+std::vector<Document> ShardedSearchServer::FindTopDocuments(const ExecutionPolicy& policy, std::string_view raw_query, DocumentStatus status) const {
+    return FindTopDocuments(policy, raw_query, status, MAX_RESULT_DOCUMENT_COUNT);
+}
+
+template<typename ExecutionPolicy>
+std::vector<Document> ShardedSearchServer::FindTopDocuments(const ExecutionPolicy& policy, std::string_view raw_query) const {
+    return FindTopDocuments(policy, raw_query, DocumentStatus::ACTUAL);
+}
@@ -0,0 +1,84 @@
+#pragma once
+
+#include <string>
+#include <cstddef>
+#include <cstdint>
+
+// Layout of the index snapshot file written by SearchServer::SaveSnapshot.
+// All integers are stored in the byte order of the machine that wrote the file,
+// every section starts at a multiple of SNAPSHOT_ALIGNMENT, offsets are counted from the file start.
+
+static const char SNAPSHOT_MAGIC[8] = {'S', 'R', 'C', 'H', 'S', 'N', 'A', 'P'};
+// version 2: posting block headers store the maximum term frequency of the block
+// version 3: postings refer to documents by ordinal, see SnapshotDocument::ordinal
+// version 4: the header stores the ordinal count, which bounds the ordinals and the posting document ids
+static const uint32_t SNAPSHOT_VERSION = 4;
+static const uint32_t SNAPSHOT_BYTE_ORDER_MARK = 0x01020304;
+static const size_t SNAPSHOT_ALIGNMENT = 8;
+
+struct SnapshotString {
+    uint64_t offset;
+    uint64_t size;
+};
+
+struct SnapshotHeader {
+    char magic[8];
+    uint32_t version;
+    uint32_t byte_order_mark;
+    uint64_t file_size;
+    uint64_t stop_word_count;
+    uint64_t term_count;
+    uint64_t document_count;
+    uint64_t ordinal_count;     // ordinals of the saved server, removed documents leave theirs unused
+    uint64_t stop_words_offset; // SnapshotString[stop_word_count]
+    uint64_t terms_offset;      // SnapshotTerm[term_count], in term id order
+    uint64_t documents_offset;  // SnapshotDocument[document_count], sorted by id
+    uint64_t words_offset;      // SnapshotWord[], words of every document sorted by term index
+    uint64_t blocks_offset;     // compressed posting blocks of every term, aligned, see PostingList::AppendEncoded
+    uint64_t postings_offset;   // compressed posting data
+    uint64_t strings_offset;    // characters of stop words, terms and document texts
+};
+
+struct SnapshotTerm {
+    SnapshotString text;
+    uint64_t blocks_offset;
+    uint64_t blocks_size;
+    uint64_t postings_offset;
+    uint64_t postings_size;
+    uint64_t posting_count;
+};
+
+struct SnapshotDocument {
+    int32_t id;
+    int32_t rating;
+    int32_t status;
+    uint32_t word_count;   // number of distinct words
+    uint32_t ordinal;      // internal number of the document used by the postings
+    uint32_t reserved;
+    SnapshotString text;
+    uint64_t words_offset;
+};
+
+struct SnapshotWord {
+    uint32_t term_index;
+    uint32_t reserved;
+    double term_freq;
+};
+
+// Read-only memory mapping of a whole file, throws std::runtime_error if the file can't be mapped
+class MappedFile {
+public:
+    explicit MappedFile(const std::string& path);
+    ~MappedFile();
+
+    MappedFile(const MappedFile&) = delete;
+    MappedFile& operator=(const MappedFile&) = delete;
+
+    const uint8_t* data() const;
+
+    size_t size() const;
+
+private:
+    const uint8_t* data_ = nullptr;
+    size_t size_ = 0;
+};
@@ -0,0 +1,93 @@
+#include <algorithm>
+
+#include "stop_word_set.h"
+
+bool StopWordSet::Contains(std::string_view word) const {
+    if (word.empty() || slots_.empty()) {
+        return false;
+    }
+    if ((length_mask_ >> std::min(word.size(), MAX_MASKED_LENGTH) & 1) == 0) {
+        return false;
+    }
+    const unsigned char first_byte = word[0];
+    if ((first_byte_mask_[first_byte / 64] >> (first_byte % 64) & 1) == 0) {
+        return false;
+    }
+    return slots_[FindSlot(word, Hash(word))] != EMPTY_SLOT;
+}
+
+std::vector<std::string_view> StopWordSet::GetWords() const {
+    std::vector<std::string_view> words;
+    words.reserve(words_.size());
+    for (const Word& word : words_) {
+        words.push_back(GetWord(word));
+    }
+    return words;
+}
+
+size_t StopWordSet::size() const {
+    return words_.size();
+}
+
+bool StopWordSet::empty() const {
+    return words_.empty();
+}
+
+void StopWordSet::Insert(std::string_view word) {
+    if (word.empty()) {
+        return;
+    }
+    if ((words_.size() + 1) * 2 > slots_.size()) {
+        Rehash(std::max<size_t>(16, slots_.size() * 2));
+    }
+    const uint64_t hash = Hash(word);
+    const size_t slot = FindSlot(word, hash);
+    if (slots_[slot] != EMPTY_SLOT) {
+        return;
+    }
+    slots_[slot] = words_.size();
+    words_.push_back({static_cast<uint32_t>(chars_.size()), static_cast<uint32_t>(word.size()), hash});
+    chars_.insert(chars_.end(), word.begin(), word.end());
+    length_mask_ |= uint64_t{1} << std::min(word.size(), MAX_MASKED_LENGTH);
+    const unsigned char first_byte = word[0];
+    first_byte_mask_[first_byte / 64] |= uint64_t{1} << (first_byte % 64);
+}
+
+void StopWordSet::Rehash(size_t slot_count) {
+    slots_.assign(slot_count, EMPTY_SLOT);
+    for (uint32_t i = 0; i < words_.size(); ++i) {
+        size_t slot = words_[i].hash & (slot_count - 1);
+        while (slots_[slot] != EMPTY_SLOT) {
+            slot = (slot + 1) & (slot_count - 1);
+        }
+        slots_[slot] = i;
+    }
+}
+
+// Returns the slot of the word, or the empty slot where it would be inserted
+size_t StopWordSet::FindSlot(std::string_view word, uint64_t hash) const {
+    const size_t mask = slots_.size() - 1;
+    for (size_t slot = hash & mask;; slot = (slot + 1) & mask) {
+        const uint32_t index = slots_[slot];
+        if (index == EMPTY_SLOT) {
+            return slot;
+        }
+        const Word& candidate = words_[index];
+        if (candidate.hash == hash && GetWord(candidate) == word) {
+            return slot;
+        }
+    }
+}
+
+std::string_view StopWordSet::GetWord(const Word& word) const {
+    return std::string_view(chars_.data() + word.offset, word.size);
+}
+
+// FNV-1a
+uint64_t StopWordSet::Hash(std::string_view word) {
+    uint64_t hash = 0xcbf29ce484222325ull;
+    for (const char c : word) {
+        hash = (hash ^ static_cast<unsigned char>(c)) * 0x100000001b3ull;
+    }
+    return hash;
+}
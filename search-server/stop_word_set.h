@@ -0,0 +1,62 @@
+#pragma once
+
+#include <vector>
+#include <string_view>
+#include <cstddef>
+#include <cstdint>
+
+// Read-only set of stop words, filled once when a SearchServer is created. The words are kept
+// one after another in a single buffer and found through an open addressing hash table, so a
+// lookup takes a string_view and never allocates. Lengths and first bytes of the words are kept
+// as bitmasks, so most words which are not stop words are rejected before hashing
+class StopWordSet {
+public:
+    StopWordSet() = default;
+
+    // words may repeat, empty words are skipped
+    template <typename Words>
+    explicit StopWordSet(const Words& words);
+
+    bool Contains(std::string_view word) const;
+
+    // Words in the order they were given
+    std::vector<std::string_view> GetWords() const;
+
+    size_t size() const;
+
+    bool empty() const;
+
+private:
+    struct Word {
+        uint32_t offset;
+        uint32_t size;
+        uint64_t hash;
+    };
+
+    static constexpr uint32_t EMPTY_SLOT = ~uint32_t{0};
+    static constexpr size_t MAX_MASKED_LENGTH = 63;
+
+    std::vector<char> chars_;
+    std::vector<Word> words_;
+    // indexes in words_, the table size is a power of two at least twice the number of words
+    std::vector<uint32_t> slots_;
+    uint64_t length_mask_ = 0;
+    uint64_t first_byte_mask_[4] = {};
+
+    void Insert(std::string_view word);
+
+    void Rehash(size_t slot_count);
+
+    size_t FindSlot(std::string_view word, uint64_t hash) const;
+
+    std::string_view GetWord(const Word& word) const;
+
+    static uint64_t Hash(std::string_view word);
+};
+
+template <typename Words>
+StopWordSet::StopWordSet(const Words& words) {
+    for (std::string_view word : words) {
+        Insert(word);
+    }
+}
@@ -1,27 +1,146 @@
 #include "string_processing.h"
 
 #include <algorithm>
+#include <cstdint>
 
-std::vector<std::string_view> SplitIntoWords(std::string_view str) {
-    std::vector<std::string_view> result;
-    str.remove_prefix(std::min(str.size(), str.find_first_not_of(" ")));
-    const int64_t pos_end = str.npos;
-    
-    while (str.size() > 0) {
-        if (str.front() == ' ') {
-            str.remove_prefix(std::min(str.size(), str.find_first_not_of(" ")));
-            if (str.size() == 0) {
-                break;
-            }
+#if defined(__AVX2__) || defined(__SSE2__)
+#include <immintrin.h>
+#endif
+
+namespace {
+
+bool IsSpecialSymbol(char c) {
+    return static_cast<unsigned char>(c) <= 31;
+}
+
+#if defined(__AVX2__) || defined(__SSE2__)
+
+struct BlockMasks {
+    uint32_t spaces;
+    uint32_t special_symbols;
+};
+
+#if defined(__AVX2__)
+
+const size_t BLOCK_SIZE = 32;
+const uint32_t FULL_MASK = ~uint32_t{0};
+
+// Bit i of the masks is set if byte i of the block is a space or a special symbol
+BlockMasks ScanBlock(const char* data) {
+    const __m256i bytes = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(data));
+    const __m256i spaces = _mm256_cmpeq_epi8(bytes, _mm256_set1_epi8(' '));
+    //unsigned bytes <= 31 are the ones which are not changed by min(byte, 31)
+    const __m256i special_symbols = _mm256_cmpeq_epi8(_mm256_min_epu8(bytes, _mm256_set1_epi8(31)), bytes);
+    return {static_cast<uint32_t>(_mm256_movemask_epi8(spaces)), static_cast<uint32_t>(_mm256_movemask_epi8(special_symbols))};
+}
+
+#else
+
+const size_t BLOCK_SIZE = 16;
+const uint32_t FULL_MASK = 0xFFFF;
+
+// Bit i of the masks is set if byte i of the block is a space or a special symbol
+BlockMasks ScanBlock(const char* data) {
+    const __m128i bytes = _mm_loadu_si128(reinterpret_cast<const __m128i*>(data));
+    const __m128i spaces = _mm_cmpeq_epi8(bytes, _mm_set1_epi8(' '));
+    //unsigned bytes <= 31 are the ones which are not changed by min(byte, 31)
+    const __m128i special_symbols = _mm_cmpeq_epi8(_mm_min_epu8(bytes, _mm_set1_epi8(31)), bytes);
+    return {static_cast<uint32_t>(_mm_movemask_epi8(spaces)), static_cast<uint32_t>(_mm_movemask_epi8(special_symbols))};
+}
+
+#endif
+
+const char* SkipSpaces(const char* pos, const char* end) {
+    for (; static_cast<size_t>(end - pos) >= BLOCK_SIZE; pos += BLOCK_SIZE) {
+        const uint32_t non_spaces = ~ScanBlock(pos).spaces & FULL_MASK;
+        if (non_spaces != 0) {
+            return pos + __builtin_ctz(non_spaces);
         }
-        int64_t space = str.find(' ');
-        if (space == pos_end) {
-            result.push_back(str);
-            break;
+    }
+    while (pos != end && *pos == ' ') {
+        ++pos;
+    }
+    return pos;
+}
+
+// Returns the end of the word starting at pos
+const char* FindWordEnd(const char* pos, const char* end, bool& has_special_symbols) {
+    for (; static_cast<size_t>(end - pos) >= BLOCK_SIZE; pos += BLOCK_SIZE) {
+        const BlockMasks masks = ScanBlock(pos);
+        if (masks.spaces != 0) {
+            const int length = __builtin_ctz(masks.spaces);
+            has_special_symbols |= (masks.special_symbols & ((uint32_t{1} << length) - 1)) != 0;
+            return pos + length;
         }
-        result.push_back(str.substr(0, space));
-        str.remove_prefix(space);
+        has_special_symbols |= masks.special_symbols != 0;
+    }
+    for (; pos != end && *pos != ' '; ++pos) {
+        has_special_symbols |= IsSpecialSymbol(*pos);
     }
+    return pos;
+}
 
-    return result;
-}
\ No newline at end of file
+#else
+
+const char* SkipSpaces(const char* pos, const char* end) {
+    while (pos != end && *pos == ' ') {
+        ++pos;
+    }
+    return pos;
+}
+
+// Returns the end of the word starting at pos
+const char* FindWordEnd(const char* pos, const char* end, bool& has_special_symbols) {
+    for (; pos != end && *pos != ' '; ++pos) {
+        has_special_symbols |= IsSpecialSymbol(*pos);
+    }
+    return pos;
+}
+
+#endif
+
+}
+
+WordSplitter::Iterator::Iterator(const char* begin, const char* end)
+    : end_(end) {
+    FindWord(begin);
+}
+
+WordSplitter::Iterator& WordSplitter::Iterator::operator++() {
+    FindWord(word_.data() + word_.size());
+    return *this;
+}
+
+WordSplitter::Iterator WordSplitter::Iterator::operator++(int) {
+    Iterator old = *this;
+    ++*this;
+    return old;
+}
+
+void WordSplitter::Iterator::FindWord(const char* pos) {
+    pos = SkipSpaces(pos, end_);
+    if (pos == end_) {
+        word_ = {};
+        has_special_symbols_ = false;
+        return;
+    }
+    has_special_symbols_ = false;
+    const char* word_end = FindWordEnd(pos, end_, has_special_symbols_);
+    word_ = std::string_view(pos, word_end - pos);
+}
+
+std::vector<std::string_view> SplitIntoWords(std::string_view str) {
+    WordSplitter words(str);
+    return {words.begin(), words.end()};
+}
+
+bool HasSpecialSymbols(std::string_view str) {
+#if defined(__AVX2__) || defined(__SSE2__)
+    for (; str.size() >= BLOCK_SIZE; str.remove_prefix(BLOCK_SIZE)) {
+        if (ScanBlock(str.data()).special_symbols != 0) {
+            return true;
+        }
+    }
+#endif
+    return std::any_of(str.begin(), str.end(), IsSpecialSymbol);
+}
@@ -4,9 +4,76 @@
 #include <string>
 #include <string_view>
 #include <set>
+#include <cstddef>
+#include <iterator>
+
+// Splits a text into words separated by spaces without allocating. The text is scanned once,
+// in vector blocks which find the spaces and the special symbols (bytes 0-31) together
+class WordSplitter {
+public:
+    class Iterator {
+    public:
+        using iterator_category = std::forward_iterator_tag;
+        using value_type = std::string_view;
+        using difference_type = std::ptrdiff_t;
+        using pointer = const std::string_view*;
+        using reference = const std::string_view&;
+
+        Iterator() = default;
+        Iterator(const char* begin, const char* end);
+
+        const std::string_view& operator*() const {
+            return word_;
+        }
+
+        const std::string_view* operator->() const {
+            return &word_;
+        }
+
+        Iterator& operator++();
+        Iterator operator++(int);
+
+        bool operator==(const Iterator& other) const {
+            return word_.data() == other.word_.data();
+        }
+
+        bool operator!=(const Iterator& other) const {
+            return !(*this == other);
+        }
+
+        // true if the current word contains a special symbol
+        bool HasSpecialSymbols() const {
+            return has_special_symbols_;
+        }
+
+    private:
+        const char* end_ = nullptr;
+        std::string_view word_;
+        bool has_special_symbols_ = false;
+
+        void FindWord(const char* pos);
+    };
+
+    explicit WordSplitter(std::string_view text)
+        : text_(text) {
+    }
+
+    Iterator begin() const {
+        return Iterator(text_.data(), text_.data() + text_.size());
+    }
+
+    Iterator end() const {
+        return Iterator();
+    }
+
+private:
+    std::string_view text_;
+};
 
 std::vector<std::string_view> SplitIntoWords(std::string_view str);
 
+bool HasSpecialSymbols(std::string_view str);
+
 using TransparentStringSet = std::set<std::string, std::less<>>;
 
 template <typename C>
@@ -18,4 +85,4 @@ TransparentStringSet MakeUniqueNonEmptyStrings(const C& strings) {
         }
     }
     return non_empty;
-}
\ No newline at end of file
+}
@@ -0,0 +1,103 @@
+#include <algorithm>
+
+#include "term_dictionary.h"
+
+TermDictionary::TermDictionary(const TermDictionary& other)
+    : terms_(other.terms_)
+    , free_ids_(other.free_ids_) {
+    CopyTexts(other.texts_);
+}
+
+TermDictionary& TermDictionary::operator=(const TermDictionary& other) {
+    if (this != &other) {
+        terms_ = other.terms_;
+        free_ids_ = other.free_ids_;
+        free_texts_.clear();
+        CopyTexts(other.texts_);
+    }
+    return *this;
+}
+
+TermId TermDictionary::Add(std::string_view term) {
+    return Insert(term, false);
+}
+
+TermId TermDictionary::AddExternal(std::string_view term) {
+    return Insert(term, true);
+}
+
+std::optional<TermId> TermDictionary::Find(std::string_view term) const {
+    const auto it = ids_.find(term);
+    if (it == ids_.end()) {
+        return std::nullopt;
+    }
+    return it->second;
+}
+
+std::string_view TermDictionary::GetText(TermId id) const {
+    return terms_[id];
+}
+
+void TermDictionary::Remove(TermId id) {
+    const std::string_view term = terms_[id];
+    ids_.erase(term);
+    //texts of other terms are never moved, views of them given out earlier stay valid
+    if (texts_.Contains(term.data())) {
+        free_texts_[term.size()].push_back(term);
+    }
+    terms_[id] = {};
+    free_ids_.push_back(id);
+}
+
+size_t TermDictionary::GetIdLimit() const {
+    return terms_.size();
+}
+
+size_t TermDictionary::size() const {
+    return ids_.size();
+}
+
+TermId TermDictionary::Insert(std::string_view term, bool is_external) {
+    const auto it = ids_.find(term);
+    if (it != ids_.end()) {
+        return it->second;
+    }
+    std::string_view text = term;
+    if (!is_external) {
+        const auto free_it = free_texts_.find(term.size());
+        if (free_it != free_texts_.end() && !free_it->second.empty()) {
+            text = texts_.Replace(free_it->second.back(), term);
+            free_it->second.pop_back();
+        } else {
+            text = texts_.Add(term);
+        }
+    }
+    TermId id;
+    if (free_ids_.empty()) {
+        id = terms_.size();
+        terms_.push_back(text);
+    } else {
+        id = free_ids_.back();
+        free_ids_.pop_back();
+        terms_[id] = text;
+    }
+    ids_.emplace(text, id);
+    return id;
+}
+
+// Copies the terms held by source into a new arena, external texts stay where they are
+void TermDictionary::CopyTexts(const TextArena& source) {
+    TextArena texts;
+    ids_.clear();
+    for (TermId id = 0; id < terms_.size(); ++id) {
+        std::string_view& term = terms_[id];
+        if (term.empty()) {
+            continue;
+        }
+        if (source.Contains(term.data())) {
+            term = texts.Add(term);
+        }
+        ids_.emplace(term, id);
+    }
+    texts_ = std::move(texts);
+}
@@ -0,0 +1,56 @@
+#pragma once
+
+#include <vector>
+#include <optional>
+#include <unordered_map>
+#include <string_view>
+#include <cstddef>
+#include <cstdint>
+
+#include "text_arena.h"
+
+using TermId = uint32_t;
+
+// Interns terms into dense 32-bit ids. Texts of the terms are copied into a text arena and found
+// through one hash table; ids of removed terms are given to new terms, so ids stay dense.
+// Texts never move: the text returned by GetText is valid until its own term is removed, and the
+// space of removed texts is given to new terms of the same length
+class TermDictionary {
+public:
+    TermDictionary() = default;
+    // Copies the texts of the terms into the arena of the copy, external texts are shared
+    TermDictionary(const TermDictionary& other);
+    TermDictionary(TermDictionary&&) = default;
+    TermDictionary& operator=(const TermDictionary& other);
+    TermDictionary& operator=(TermDictionary&&) = default;
+
+    // Returns the id of the term, adding it if needed
+    TermId Add(std::string_view term);
+
+    // Same as Add, but a new term is not copied, the text must outlive the dictionary
+    TermId AddExternal(std::string_view term);
+
+    std::optional<TermId> Find(std::string_view term) const;
+
+    std::string_view GetText(TermId id) const;
+
+    // The id may be given to another term afterwards
+    void Remove(TermId id);
+
+    // All ids in use are less than the id limit
+    size_t GetIdLimit() const;
+
+    size_t size() const;
+
+private:
+    TextArena texts_;
+    std::vector<std::string_view> terms_;
+    std::unordered_map<std::string_view, TermId> ids_;
+    std::vector<TermId> free_ids_;
+    // arena texts of removed terms by their length
+    std::unordered_map<size_t, std::vector<std::string_view>> free_texts_;
+
+    TermId Insert(std::string_view term, bool is_external);
+
+    void CopyTexts(const TextArena& source);
+};
@@ -3,11 +3,37 @@
 #include <map>
 #include <vector>
 #include <set>
+#include <cmath>
+#include <limits>
+#include <algorithm>
+#include <execution>
+#include <fstream>
+#include <cstdio>
+#include <thread>
+#include <atomic>
+#include <random>
+#include <chrono>
+#include <optional>
+#include <cstring>
+#include <cstddef>
+#include <iterator>
 
 #include "test_example_functions.h"
 #include "search_server.h"
 #include "paginator.h"
 #include "remove_duplicates.h"
+#include "posting_codec.h"
+#include "sharded_search_server.h"
+#include "text_arena.h"
+#include "string_processing.h"
+#include "stop_word_set.h"
+#include "term_dictionary.h"
+#include "versioned_search_server.h"
+#include "request_queue.h"
+#include "document_id_set.h"
+#include "thread_pool.h"
+#include "process_queries.h"
+#include "async_search_server.h"
 
 using namespace std;
 
@@ -351,6 +377,1436 @@ void TestRemoveDuplicate() {
     ASSERT_EQUAL(search_server.GetDocumentCount(), 4);
 }
 
+void TestOutOfOrderDocuments() {
+    SearchServer search_server;
+    const int document_count = 200;
+    for (int id = document_count - 1; id >= 0; --id) {
+        search_server.AddDocument(id, id % 2 == 0 ? "even cat"sv : "odd cat"sv, DocumentStatus::ACTUAL, {id});
+    }
+    for (int id = 0; id < document_count; id += 4) {
+        search_server.RemoveDocument(id);
+    }
+
+    const auto word_freqs = search_server.GetWordToFreqs();
+    ASSERT_EQUAL(word_freqs.at("cat"sv).size(), 150);
+    ASSERT_EQUAL(word_freqs.at("even"sv).size(), 50);
+    ASSERT_EQUAL(word_freqs.at("odd"sv).size(), 100);
+    ASSERT_EQUAL(word_freqs.at("even"sv).begin()->first, 2);
+
+    ASSERT_EQUAL(std::get<0>(search_server.MatchDocument("even odd"sv, 6)), std::vector<std::string_view>{"even"sv});
+    ASSERT_EQUAL(std::get<0>(search_server.MatchDocument(std::execution::par, "even odd"sv, 7)), std::vector<std::string_view>{"odd"sv});
+    ASSERT_EQUAL(search_server.FindTopDocuments("even"sv).size(), 5);
+    ASSERT_EQUAL(search_server.FindTopDocuments("even"sv)[0].id, 198);
+}
+
+void TestRemoveDocumentOwningWordText() {
+    SearchServer search_server;
+    search_server.AddDocument(1, "white cat"sv, DocumentStatus::ACTUAL, {1});
+    search_server.AddDocument(2, "white dog"sv, DocumentStatus::ACTUAL, {2});
+    search_server.RemoveDocument(1);
+    search_server.AddDocument(3, "black cat"sv, DocumentStatus::ACTUAL, {3});
+
+    const auto docs = search_server.FindTopDocuments("white cat"sv);
+    ASSERT_EQUAL(docs.size(), 2);
+    ASSERT_EQUAL(std::get<0>(search_server.MatchDocument("white"sv, 2)), std::vector<std::string_view>{"white"sv});
+}
+
+void TestMaxResultDocumentCount() {
+    SearchServer search_server;
+    const int document_count = 100;
+    for (int id = 0; id < document_count; ++id) {
+        const std::string text = "cat"s + std::string(id % 7 + 1, 'a') + " cat tail"s;
+        search_server.AddDocument(id, text, DocumentStatus::ACTUAL, {id % 10});
+    }
+
+    const auto all_docs = search_server.FindTopDocuments("cat tail"sv, DocumentStatus::ACTUAL, document_count);
+    ASSERT_EQUAL(all_docs.size(), document_count);
+    for (size_t i = 1; i < all_docs.size(); ++i) {
+        ASSERT(!IsMoreRelevant(all_docs[i], all_docs[i - 1]));
+    }
+
+    for (int max_count : {0, 1, 3, 17}) {
+        const auto seq_docs = search_server.FindTopDocuments("cat tail"sv, DocumentStatus::ACTUAL, max_count);
+        const auto par_docs = search_server.FindTopDocuments(std::execution::par, "cat tail"sv, DocumentStatus::ACTUAL, max_count);
+        ASSERT_EQUAL(seq_docs.size(), static_cast<size_t>(max_count));
+        ASSERT_EQUAL(par_docs.size(), static_cast<size_t>(max_count));
+        for (int i = 0; i < max_count; ++i) {
+            ASSERT_EQUAL(seq_docs[i].id, all_docs[i].id);
+            ASSERT_EQUAL(par_docs[i].id, all_docs[i].id);
+        }
+    }
+
+    ASSERT_EQUAL(search_server.FindTopDocuments("cat tail"sv).size(), MAX_RESULT_DOCUMENT_COUNT);
+
+    bool thrown = false;
+    try {
+        search_server.FindTopDocuments("cat"sv, DocumentStatus::ACTUAL, -1);
+    } catch (const std::invalid_argument&) {
+        thrown = true;
+    }
+    ASSERT(thrown);
+}
+
+void TestSparseDocumentIds() {
+    SearchServer search_server;
+    std::vector<int> ids;
+    for (int i = 0; i < 300; ++i) {
+        ids.push_back(i * 7919);
+    }
+    ids.push_back(std::numeric_limits<int>::max());
+    for (int id : ids) {
+        const std::string text = id % 3 == 0 ? "grey cat"s : "grey dog"s;
+        search_server.AddDocument(id, text, DocumentStatus::ACTUAL, {id % 100});
+    }
+
+    const int max_count = ids.size();
+    const auto seq_docs = search_server.FindTopDocuments("grey cat -dog"sv, DocumentStatus::ACTUAL, max_count);
+    const auto par_docs = search_server.FindTopDocuments(std::execution::par, "grey cat -dog"sv, DocumentStatus::ACTUAL, max_count);
+    const auto expected_count = std::count_if(ids.begin(), ids.end(), [](int id) { return id % 3 == 0; });
+    ASSERT_EQUAL(seq_docs.size(), static_cast<size_t>(expected_count));
+    ASSERT_EQUAL(par_docs.size(), seq_docs.size());
+    for (size_t i = 0; i < seq_docs.size(); ++i) {
+        ASSERT_EQUAL(seq_docs[i].id % 3, 0);
+        ASSERT_EQUAL(par_docs[i].id, seq_docs[i].id);
+        ASSERT_EQUAL(par_docs[i].relevance, seq_docs[i].relevance);
+    }
+    ASSERT_EQUAL(search_server.FindTopDocuments("grey -cat"sv, DocumentStatus::ACTUAL, max_count).size(), ids.size() - expected_count);
+}
+
+void TestInverseDocumentFreqRefresh() {
+    SearchServer search_server;
+    search_server.AddDocument(1, "cat"sv, DocumentStatus::ACTUAL, {1});
+    search_server.AddDocument(2, "dog"sv, DocumentStatus::ACTUAL, {1});
+    ASSERT(std::abs(search_server.FindTopDocuments("cat"sv)[0].relevance - std::log(2.0)) < RELEVANCE_THRESHOLD);
+
+    search_server.AddDocument(3, "dog"sv, DocumentStatus::ACTUAL, {1});
+    search_server.AddDocument(4, "dog"sv, DocumentStatus::ACTUAL, {1});
+    ASSERT(std::abs(search_server.FindTopDocuments("cat"sv)[0].relevance - std::log(4.0)) < RELEVANCE_THRESHOLD);
+
+    search_server.AddDocument(5, "cat"sv, DocumentStatus::ACTUAL, {1});
+    ASSERT(std::abs(search_server.FindTopDocuments("cat"sv)[0].relevance - std::log(5.0 / 2.0)) < RELEVANCE_THRESHOLD);
+
+    search_server.RemoveDocument(5);
+    search_server.RemoveDocument(4);
+    ASSERT(std::abs(search_server.FindTopDocuments("cat"sv)[0].relevance - std::log(3.0)) < RELEVANCE_THRESHOLD);
+}
+
+void TestPostingCodec() {
+    std::vector<uint32_t> values;
+    for (uint32_t i = 0; i < 300; ++i) {
+        values.push_back((i * 2654435761u) >> (i % 3 == 0 ? 24 : (i % 3 == 1 ? 17 : 1)));
+    }
+    for (size_t size : {0, 1, 3, 4, 7, 8, 9, 17, 128, 300}) {
+        const uint32_t max_value = size == 0 ? 0 : *std::max_element(values.begin(), values.begin() + size);
+        const int width = GetByteWidth(max_value);
+        std::vector<uint8_t> data;
+        EncodeUnsigned(values.data(), size, width, data);
+        ASSERT_EQUAL(data.size(), size * width);
+
+        std::vector<uint32_t> decoded(size);
+        DecodeUnsigned(data.data(), size, width, decoded.data());
+        ASSERT(std::equal(decoded.begin(), decoded.end(), values.begin()));
+
+        std::vector<uint32_t> small_deltas(size);
+        std::transform(values.begin(), values.begin() + size, small_deltas.begin(), [](uint32_t value) { return value % 1000; });
+        std::vector<uint8_t> delta_data;
+        const int delta_width = GetByteWidth(1000);
+        EncodeUnsigned(small_deltas.data(), size, delta_width, delta_data);
+        std::vector<int> ids(size);
+        std::vector<int> expected_ids(size);
+        DecodeDocumentIds(delta_data.data(), size, delta_width, 12345, ids.data());
+        DecodeDocumentIdsScalar(delta_data.data(), size, delta_width, 12345, expected_ids.data());
+        ASSERT_EQUAL(ids, expected_ids);
+        int id = 12345;
+        for (size_t i = 0; i < size; ++i) {
+            id += small_deltas[i];
+            ASSERT_EQUAL(ids[i], id);
+        }
+    }
+
+    //every decoder the CPU supports gives the scalar results, whatever the build flags are
+    const std::vector<PostingDecoder>& decoders = GetPostingDecoders();
+    ASSERT_EQUAL(std::string(decoders.front().name), std::string(GetPostingDecoderName()));
+    ASSERT_EQUAL(std::string(decoders.back().name), "scalar"s);
+    for (int width : {1, 2, 4}) {
+        const uint32_t mask = width == 4 ? ~uint32_t{0} : (uint32_t{1} << (8 * width)) - 1;
+        std::vector<uint32_t> width_values(values.size());
+        std::transform(values.begin(), values.end(), width_values.begin(), [mask](uint32_t value) { return value & mask; });
+        std::vector<uint8_t> data;
+        EncodeUnsigned(width_values.data(), width_values.size(), width, data);
+        for (size_t size : {0, 1, 3, 4, 7, 8, 9, 17, 128, 300}) {
+            std::vector<uint32_t> expected_values(size);
+            std::vector<int> expected_ids(size);
+            DecodeUnsignedScalar(data.data(), size, width, expected_values.data());
+            DecodeDocumentIdsScalar(data.data(), size, width, -7, expected_ids.data());
+            for (const PostingDecoder& decoder : decoders) {
+                std::vector<uint32_t> decoded(size);
+                std::vector<int> ids(size);
+                decoder.decode_unsigned(data.data(), size, width, decoded.data());
+                decoder.decode_document_ids(data.data(), size, width, -7, ids.data());
+                ASSERT_EQUAL_HINT(decoded, expected_values, decoder.name);
+                ASSERT_EQUAL_HINT(ids, expected_ids, decoder.name);
+            }
+        }
+    }
+}
+
+void TestCompressedIndex() {
+    const std::vector<std::string> words = {"cat"s, "dog"s, "bird"s, "fish"s, "frog"s};
+    std::map<int, std::map<std::string, int>> document_word_counts;
+    std::map<int, int> document_sizes;
+    SearchServer search_server;
+    for (int i = 0; i < 1000; ++i) {
+        const int id = (i * 7919) % 1000 * 3;
+        std::string text;
+        const int size = 1 + i % 7;
+        for (int j = 0; j < size; ++j) {
+            const std::string& word = words[(i * j + j * j + i / 3) % words.size()];
+            text += word + " "s;
+            ++document_word_counts[id][word];
+        }
+        document_sizes[id] = size;
+        search_server.AddDocument(id, text, DocumentStatus::ACTUAL, {i % 13});
+    }
+    for (int id = 0; id < 3000; id += 21) {
+        search_server.RemoveDocument(id);
+        document_word_counts.erase(id);
+    }
+
+    const auto check_relevance = [&](const std::vector<std::string>& query_words) {
+        std::string query;
+        for (const std::string& word : query_words) {
+            query += word + " "s;
+        }
+        const auto docs = search_server.FindTopDocuments(query, DocumentStatus::ACTUAL, 3000);
+        std::map<int, double> expected_relevance;
+        for (const std::string& word : query_words) {
+            int document_freq = 0;
+            for (const auto& [id, word_counts] : document_word_counts) {
+                document_freq += word_counts.count(word);
+            }
+            for (const auto& [id, word_counts] : document_word_counts) {
+                if (word_counts.count(word) > 0) {
+                    expected_relevance[id] += word_counts.at(word) * 1.0 / document_sizes.at(id) * std::log(document_word_counts.size() * 1.0 / document_freq);
+                }
+            }
+        }
+        ASSERT_EQUAL(docs.size(), expected_relevance.size());
+        for (const Document& doc : docs) {
+            ASSERT(std::abs(doc.relevance - expected_relevance.at(doc.id)) < RELEVANCE_THRESHOLD);
+        }
+    };
+
+    check_relevance({"cat"s, "frog"s});
+    search_server.CompactIndex();
+    check_relevance({"cat"s, "frog"s});
+    check_relevance({"dog"s, "bird"s, "fish"s});
+
+    for (const auto& [id, word_counts] : document_word_counts) {
+        const auto [matched_words, status] = search_server.MatchDocument("cat dog"sv, id);
+        ASSERT_EQUAL(matched_words.size(), word_counts.count("cat"s) + word_counts.count("dog"s));
+    }
+
+    const IndexStats stats = search_server.GetIndexStats();
+    ASSERT_EQUAL(stats.posting_count, search_server.GetWordToFreqs().at("cat"sv).size() + search_server.GetWordToFreqs().at("dog"sv).size()
+        + search_server.GetWordToFreqs().at("bird"sv).size() + search_server.GetWordToFreqs().at("fish"sv).size()
+        + search_server.GetWordToFreqs().at("frog"sv).size());
+    ASSERT(stats.bytes_per_posting < sizeof(Posting));
+
+    //a moved list keeps its blocks and cached statistics, the source is left empty
+    PostingList postings;
+    for (int id = 0; id < 1000; ++id) {
+        postings.Add(id * 2, 1 + id % 3, 4);
+    }
+    postings.Compact();
+    const double inverse_document_freq = postings.GetInverseDocumentFreq(4000);
+    PostingList moved_postings(std::move(postings));
+    ASSERT_EQUAL(moved_postings.size(), 1000u);
+    ASSERT(moved_postings.Contains(998));
+    ASSERT_EQUAL(moved_postings.GetInverseDocumentFreq(4000), inverse_document_freq);
+    ASSERT(postings.empty());
+    postings = std::move(moved_postings);
+    ASSERT_EQUAL(postings.size(), 1000u);
+    ASSERT_EQUAL(postings.Find(1000)->term_freq, 0.75);
+    ASSERT(moved_postings.empty());
+    moved_postings.Add(7, 1, 1);
+    ASSERT_EQUAL(moved_postings.size(), 1u);
+}
+
+namespace {
+
+//count texts of 1 to 6 words of a small vocabulary with the stop words "in" and "the",
+//the seed changes which words the texts get
+std::vector<std::string> MakeTestTexts(int count, int seed) {
+    const std::vector<std::string> words = {"cat"s, "dog"s, "in"s, "bird"s, "fish"s, "the"s, "frog"s, "pond"s, "tail"s};
+    std::vector<std::string> texts(count);
+    for (int i = 0; i < count; ++i) {
+        for (int j = 0; j < 1 + i % 6; ++j) {
+            texts[i] += words[(i * j + i / seed) % words.size()] + " "s;
+        }
+    }
+    return texts;
+}
+
+}
+
+void TestSnapshot() {
+    const std::vector<std::string> texts = MakeTestTexts(600, 4);
+    SearchServer search_server("in the"s);
+    for (int i = 0; i < 600; ++i) {
+        search_server.AddDocument((i * 37) % 600 * 2, texts[i], static_cast<DocumentStatus>(i % 3), {i % 11, i % 5});
+    }
+    for (int id = 0; id < 1200; id += 34) {
+        search_server.RemoveDocument(id);
+    }
+
+    const std::string path = "search_server_test.snapshot"s;
+    search_server.SaveSnapshot(path);
+    SearchServer loaded_server = SearchServer::LoadSnapshot(path);
+
+    const auto check_equal = [](const SearchServer& lhs, const SearchServer& rhs) {
+        ASSERT_EQUAL(lhs.GetDocumentCount(), rhs.GetDocumentCount());
+        ASSERT(std::equal(lhs.begin(), lhs.end(), rhs.begin(), rhs.end()));
+        ASSERT(lhs.GetWordToFreqs() == rhs.GetWordToFreqs());
+        for (const std::string& query : {"cat frog"s, "dog -fish"s, "bird the"s, "-cat"s}) {
+            const auto lhs_docs = lhs.FindTopDocuments(query, [](int, DocumentStatus, int) { return true; }, 1200);
+            const auto rhs_docs = rhs.FindTopDocuments(std::execution::par, query, [](int, DocumentStatus, int) { return true; }, 1200);
+            ASSERT_EQUAL(lhs_docs.size(), rhs_docs.size());
+            for (size_t i = 0; i < lhs_docs.size(); ++i) {
+                ASSERT_EQUAL(lhs_docs[i].id, rhs_docs[i].id);
+                ASSERT_EQUAL(lhs_docs[i].rating, rhs_docs[i].rating);
+                ASSERT(lhs_docs[i].status == rhs_docs[i].status);
+                ASSERT(std::abs(lhs_docs[i].relevance - rhs_docs[i].relevance) < RELEVANCE_THRESHOLD);
+            }
+        }
+        for (int id : lhs) {
+            ASSERT(lhs.GetWordFrequencies(id) == rhs.GetWordFrequencies(id));
+            ASSERT(lhs.MatchDocument("cat dog -frog"sv, id) == rhs.MatchDocument("cat dog -frog"sv, id));
+        }
+    };
+    check_equal(search_server, loaded_server);
+
+    for (SearchServer* server : {&search_server, &loaded_server}) {
+        server->AddDocument(1201, "cat and a new dog"s, DocumentStatus::ACTUAL, {5});
+        for (int id = 2; id < 1200; id += 6) {
+            server->RemoveDocument(std::execution::par, id);
+        }
+    }
+    check_equal(search_server, loaded_server);
+
+    loaded_server.SaveSnapshot(path);
+    check_equal(search_server, SearchServer::LoadSnapshot(path));
+    {
+        const SearchServer loaded_copy = SearchServer::LoadSnapshot(path);
+        const SearchServer copied_server = loaded_copy;
+        check_equal(search_server, copied_server);
+    }
+
+    std::string contents;
+    {
+        std::ifstream in(path, std::ios::binary);
+        contents.assign(std::istreambuf_iterator<char>(in), std::istreambuf_iterator<char>());
+    }
+    SnapshotHeader header;
+    std::memcpy(&header, contents.data(), sizeof(header));
+    SnapshotTerm term;
+    std::memcpy(&term, contents.data() + header.terms_offset, sizeof(term));
+    const auto check_broken = [&path](const std::string& broken_contents) {
+        {
+            std::ofstream out(path, std::ios::binary | std::ios::trunc);
+            out << broken_contents;
+        }
+        try {
+            SearchServer::LoadSnapshot(path);
+            ASSERT_HINT(false, "Loading a broken snapshot must throw"s);
+        } catch (const std::runtime_error&) {
+        }
+    };
+    check_broken("not a snapshot"s);
+    {
+        std::string broken_contents = contents;
+        const uint32_t ordinal = header.ordinal_count;
+        std::memcpy(broken_contents.data() + header.documents_offset + offsetof(SnapshotDocument, ordinal), &ordinal, sizeof(ordinal));
+        check_broken(broken_contents);
+    }
+    {
+        //last document id of the first block of the first term
+        std::string broken_contents = contents;
+        const int last_document_id = header.ordinal_count;
+        std::memcpy(broken_contents.data() + header.blocks_offset + term.blocks_offset + sizeof(int), &last_document_id, sizeof(int));
+        check_broken(broken_contents);
+    }
+    {
+        std::string broken_contents = contents;
+        const uint64_t postings_size = term.postings_size - 1;
+        std::memcpy(broken_contents.data() + header.terms_offset + offsetof(SnapshotTerm, postings_size), &postings_size, sizeof(postings_size));
+        check_broken(broken_contents);
+    }
+    {
+        //the second byte of the first block of the longest list is in the first delta, which must be 0,
+        //or in the second delta, which then no longer sums up to the last id of the block
+        SnapshotTerm longest_term = term;
+        for (uint64_t i = 0; i < header.term_count; ++i) {
+            SnapshotTerm other_term;
+            std::memcpy(&other_term, contents.data() + header.terms_offset + i * sizeof(SnapshotTerm), sizeof(other_term));
+            if (other_term.posting_count > longest_term.posting_count) {
+                longest_term = other_term;
+            }
+        }
+        ASSERT(longest_term.posting_count > 1);
+        std::string broken_contents = contents;
+        broken_contents[header.postings_offset + longest_term.postings_offset + 1] ^= 0x80;
+        check_broken(broken_contents);
+    }
+    std::remove(path.c_str());
+}
+
+void TestAddDocuments() {
+    const std::vector<std::string> texts = MakeTestTexts(1000, 5);
+
+    SearchServer expected_server("in the"s);
+    SearchServer batch_server("in the"s);
+    expected_server.AddDocument(5000, "frog in the pond"s, DocumentStatus::ACTUAL, {1});
+    batch_server.AddDocument(5000, "frog in the pond"s, DocumentStatus::ACTUAL, {1});
+    std::vector<DocumentToAdd> first_batch;
+    std::vector<DocumentToAdd> second_batch;
+    for (int i = 0; i < 1000; ++i) {
+        const int id = (i * 37) % 1000 * 3;
+        expected_server.AddDocument(id, texts[i], static_cast<DocumentStatus>(i % 3), {i % 7, i % 3});
+        (i % 4 == 0 ? first_batch : second_batch).push_back({id, texts[i], static_cast<DocumentStatus>(i % 3), {i % 7, i % 3}});
+    }
+    batch_server.AddDocuments(first_batch);
+    batch_server.AddDocuments(std::execution::par, second_batch);
+
+    ASSERT_EQUAL(batch_server.GetDocumentCount(), expected_server.GetDocumentCount());
+    ASSERT(batch_server.GetWordToFreqs() == expected_server.GetWordToFreqs());
+    for (int id : expected_server) {
+        ASSERT(batch_server.GetWordFrequencies(id) == expected_server.GetWordFrequencies(id));
+    }
+    for (const std::string& query : {"cat frog"s, "dog -fish"s, "bird the"s}) {
+        const auto expected_docs = expected_server.FindTopDocuments(query, DocumentStatus::IRRELEVANT, 1000);
+        const auto docs = batch_server.FindTopDocuments(query, DocumentStatus::IRRELEVANT, 1000);
+        ASSERT_EQUAL(docs.size(), expected_docs.size());
+        for (size_t i = 0; i < docs.size(); ++i) {
+            ASSERT_EQUAL(docs[i].id, expected_docs[i].id);
+            ASSERT_EQUAL(docs[i].rating, expected_docs[i].rating);
+            ASSERT(std::abs(docs[i].relevance - expected_docs[i].relevance) < RELEVANCE_THRESHOLD);
+        }
+    }
+
+    const std::vector<DocumentToAdd> bad_batch = {
+        {7001, "good document"sv, DocumentStatus::ACTUAL, {1}},
+        {-1, "negative id"sv, DocumentStatus::ACTUAL, {1}},
+        {3, "existing id"sv, DocumentStatus::ACTUAL, {1}},
+        {7002, "special \x12 symbol"sv, DocumentStatus::ACTUAL, {1}},
+        {7001, "repeated id"sv, DocumentStatus::ACTUAL, {1}},
+    };
+    try {
+        batch_server.AddDocuments(std::execution::par, bad_batch);
+        ASSERT_HINT(false, "Invalid batch must be rejected"s);
+    } catch (const std::invalid_argument& e) {
+        const std::string message = e.what();
+        for (const std::string& id : {"-1: "s, "3: "s, "7002: "s, "7001: "s}) {
+            ASSERT_HINT(message.find(id) != std::string::npos, message);
+        }
+    }
+    ASSERT_EQUAL(batch_server.GetDocumentCount(), expected_server.GetDocumentCount());
+    ASSERT(batch_server.FindTopDocuments("good"s).empty());
+}
+
+void TestShardedSearchServer() {
+    SearchServer search_server("in the"s);
+    ShardedSearchServer sharded_server(4, "in the"s);
+    std::vector<DocumentToAdd> batch;
+    const std::vector<std::string> texts = MakeTestTexts(800, 7);
+    for (int i = 0; i < 800; ++i) {
+        search_server.AddDocument(i * 2, texts[i], static_cast<DocumentStatus>(i % 3), {i % 9});
+        if (i % 2 == 0) {
+            sharded_server.AddDocument(i * 2, texts[i], static_cast<DocumentStatus>(i % 3), {i % 9});
+        } else {
+            batch.push_back({i * 2, texts[i], static_cast<DocumentStatus>(i % 3), {i % 9}});
+        }
+    }
+    sharded_server.AddDocuments(std::execution::par, batch);
+    for (size_t i = 0; i < sharded_server.GetShardCount(); ++i) {
+        ASSERT(sharded_server.GetShard(i).GetDocumentCount() > 0);
+    }
+
+    const auto check_equal = [&]() {
+        ASSERT_EQUAL(sharded_server.GetDocumentCount(), search_server.GetDocumentCount());
+        for (const std::string& query : {"cat frog"s, "dog -fish"s, "bird the pond"s, "frog"s}) {
+            const auto expected_docs = search_server.FindTopDocuments(query, DocumentStatus::ACTUAL, 300);
+            const auto docs = sharded_server.FindTopDocuments(std::execution::par, query, DocumentStatus::ACTUAL, 300);
+            ASSERT_EQUAL(docs.size(), expected_docs.size());
+            for (size_t i = 0; i < docs.size(); ++i) {
+                ASSERT_EQUAL(docs[i].id, expected_docs[i].id);
+                ASSERT_EQUAL(docs[i].relevance, expected_docs[i].relevance);
+            }
+            ASSERT_EQUAL(sharded_server.FindTopDocuments(query).size(), search_server.FindTopDocuments(query).size());
+        }
+        for (int id : search_server) {
+            ASSERT(sharded_server.MatchDocument("cat pond -dog"sv, id) == search_server.MatchDocument("cat pond -dog"sv, id));
+            ASSERT(sharded_server.GetWordFrequencies(id) == search_server.GetWordFrequencies(id));
+        }
+    };
+    check_equal();
+
+    for (int id = 0; id < 1600; id += 6) {
+        search_server.RemoveDocument(id);
+        sharded_server.RemoveDocument(std::execution::par, id);
+    }
+    check_equal();
+
+    try {
+        sharded_server.AddDocuments({{5001, "new document"sv, DocumentStatus::ACTUAL, {1}}, {2, "existing id"sv, DocumentStatus::ACTUAL, {1}}});
+        ASSERT_HINT(false, "Invalid batch must be rejected"s);
+    } catch (const std::invalid_argument&) {
+    }
+    ASSERT_EQUAL(sharded_server.GetDocumentCount(), search_server.GetDocumentCount());
+}
+
+void TestVersionedSearchServer() {
+    VersionedSearchServer search_server("and"s);
+    search_server.AddDocument(0, "white cat"s, DocumentStatus::ACTUAL, {1});
+
+    //every change adds or removes a pair of documents, so readers must always see an even number of dogs
+    std::atomic<bool> is_writing = true;
+    std::atomic<int> odd_results = 0;
+    std::vector<std::thread> readers;
+    for (int i = 0; i < 2; ++i) {
+        readers.emplace_back([&]() {
+            do {
+                const size_t found = search_server.FindTopDocuments("dog"s, DocumentStatus::ACTUAL, 1000).size();
+                const int document_count = search_server.Read([](const SearchServer& server) {
+                    return server.GetDocumentCount();
+                });
+                if (found % 2 != 0 || document_count % 2 != 1) {
+                    ++odd_results;
+                }
+            } while (is_writing);
+        });
+    }
+    for (int i = 1; i <= 200; ++i) {
+        search_server.AddDocuments({{2 * i, "brown dog"sv, DocumentStatus::ACTUAL, {2}}, {2 * i + 1, "dog and cat"sv, DocumentStatus::ACTUAL, {3}}});
+        if (i % 3 == 0) {
+            search_server.Update([i](SearchServer& server) {
+                server.RemoveDocument(2 * i - 2);
+                server.RemoveDocument(2 * i - 1);
+            });
+        }
+    }
+    is_writing = false;
+    for (std::thread& reader : readers) {
+        reader.join();
+    }
+
+    ASSERT_EQUAL(odd_results.load(), 0);
+    ASSERT_EQUAL(search_server.GetVersion(), 267u);
+    ASSERT_EQUAL(search_server.GetDocumentCount(), 1 + 2 * (200 - 66));
+    try {
+        search_server.AddDocument(0, "duplicate id"s, DocumentStatus::ACTUAL, {1});
+        ASSERT_HINT(false, "Adding a document with an existing id must throw"s);
+    } catch (const std::invalid_argument&) {
+    }
+    ASSERT_EQUAL(search_server.GetVersion(), 267u);
+    ASSERT_EQUAL(search_server.FindTopDocuments("duplicate"s).size(), 0u);
+}
+
+void TestRequestQueueCache() {
+    SearchServer search_server("and"s);
+    search_server.AddDocument(1, "white cat and dog"s, DocumentStatus::ACTUAL, {1});
+    search_server.AddDocument(2, "black dog"s, DocumentStatus::ACTUAL, {2});
+    search_server.AddDocument(3, "grey cat"s, DocumentStatus::BANNED, {3});
+    RequestQueue request_queue(search_server, 2);
+
+    const auto first = request_queue.AddFindRequest("cat dog -parrot"s);
+    ASSERT_EQUAL(first.size(), 2u);
+    const auto second = request_queue.AddFindRequest("dog and cat cat -parrot"s);
+    ASSERT_EQUAL(second.size(), 2u);
+    ASSERT_EQUAL(second[0].id, first[0].id);
+    ASSERT_EQUAL(request_queue.GetCacheStats().hits, 1u);
+    ASSERT_EQUAL(request_queue.GetCacheStats().misses, 1u);
+
+    ASSERT_EQUAL(request_queue.AddFindRequest("cat dog -parrot"s, DocumentStatus::BANNED).size(), 1u);
+    const auto is_even = [](int document_id, DocumentStatus, int) { return document_id % 2 == 0; };
+    ASSERT_EQUAL(request_queue.AddFindRequest("cat dog -parrot"s, is_even).size(), 1u);
+    ASSERT_EQUAL(request_queue.AddFindRequest("-parrot cat dog"s, is_even).size(), 1u);
+    ASSERT_EQUAL(request_queue.GetCacheStats().hits, 2u);
+    ASSERT_EQUAL(request_queue.GetCacheStats().misses, 3u);
+
+    //predicates with state are not cached
+    const int wanted_id = 3;
+    const auto is_wanted = [wanted_id](int document_id, DocumentStatus, int) { return document_id == wanted_id; };
+    ASSERT_EQUAL(request_queue.AddFindRequest("cat"s, is_wanted).size(), 1u);
+    ASSERT_EQUAL(request_queue.GetCacheStats().misses, 3u);
+
+    //the first query was evicted by the two later ones
+    request_queue.AddFindRequest("cat dog -parrot"s);
+    ASSERT_EQUAL(request_queue.GetCacheStats().misses, 4u);
+
+    search_server.AddDocument(4, "cat parrot"s, DocumentStatus::ACTUAL, {4});
+    search_server.AddDocument(5, "cat dog"s, DocumentStatus::ACTUAL, {5});
+    ASSERT_EQUAL(request_queue.AddFindRequest("cat dog -parrot"s).size(), 3u);
+    search_server.RemoveDocument(5);
+    ASSERT_EQUAL(request_queue.AddFindRequest("cat dog -parrot"s).size(), 2u);
+    ASSERT_EQUAL(request_queue.GetCacheStats().hits, 2u);
+    ASSERT_EQUAL(request_queue.GetCacheStats().misses, 6u);
+    ASSERT_EQUAL(request_queue.GetNoResultRequests(), 0);
+
+    RequestQueue uncached_queue(search_server);
+    uncached_queue.AddFindRequest("cat"s);
+    uncached_queue.AddFindRequest("cat"s);
+    ASSERT_EQUAL(uncached_queue.GetCacheStats().hits + uncached_queue.GetCacheStats().misses, 0u);
+}
+
+void TestPrunedTopDocuments() {
+    //frequent words come first, so every query mixes common and rare words
+    std::vector<std::string> words;
+    for (int i = 0; i < 40; ++i) {
+        words.push_back("word"s + std::to_string(i));
+    }
+    SearchServer search_server;
+    uint32_t random = 12345;
+    const auto next_random = [&random]() {
+        random = random * 1103515245 + 12345;
+        return (random >> 8) % 10000;
+    };
+    for (int id = 0; id < 6000; ++id) {
+        std::string text;
+        const int size = 2 + next_random() % 8;
+        for (int j = 0; j < size; ++j) {
+            const uint64_t product = uint64_t{next_random()} * next_random();
+            text += words[product * words.size() / 100000000] + " "s;
+        }
+        search_server.AddDocument(id, text, static_cast<DocumentStatus>(id % 4 == 0), {static_cast<int>(next_random() % 5)});
+        if (id == 3000) {
+            search_server.CompactIndex();
+        }
+    }
+
+    const std::vector<std::string> queries = {"word0 word1"s, "word0 word7 word21"s, "word0 word1 word2 word3 -word5"s,
+        "word2 word35 word39"s, "word0 word0 word1 -word2 -word3"s, "word4 word9 word13 word17 word30"s};
+    const auto is_odd = [](int document_id, DocumentStatus, int) { return document_id % 2 == 1; };
+    for (const std::string& query : queries) {
+        const auto all_docs = search_server.FindTopDocuments(query, DocumentStatus::ACTUAL, 6000);
+        const auto all_odd_docs = search_server.FindTopDocuments(query, is_odd, 6000);
+        for (int count : {1, 5, 17, 100}) {
+            const auto docs = search_server.FindTopDocuments(query, DocumentStatus::ACTUAL, count);
+            const auto par_docs = search_server.FindTopDocuments(std::execution::par, query, DocumentStatus::ACTUAL, count);
+            const auto odd_docs = search_server.FindTopDocuments(query, is_odd, count);
+            ASSERT_EQUAL(docs.size(), std::min<size_t>(count, all_docs.size()));
+            ASSERT_EQUAL(par_docs.size(), docs.size());
+            ASSERT_EQUAL(odd_docs.size(), std::min<size_t>(count, all_odd_docs.size()));
+            for (size_t i = 0; i < docs.size(); ++i) {
+                ASSERT_EQUAL(docs[i].id, all_docs[i].id);
+                ASSERT_EQUAL(docs[i].relevance, all_docs[i].relevance);
+                ASSERT_EQUAL(par_docs[i].id, all_docs[i].id);
+            }
+            for (size_t i = 0; i < odd_docs.size(); ++i) {
+                ASSERT_EQUAL(odd_docs[i].id, all_odd_docs[i].id);
+                ASSERT_EQUAL(odd_docs[i].relevance, all_odd_docs[i].relevance);
+            }
+        }
+    }
+}
+
+void TestDocumentIdSet() {
+    //a sparse chunk, a dense chunk and ids far apart
+    std::vector<int> ids = {7, 3, 65535, 1 << 30, std::numeric_limits<int>::max(), 3};
+    std::set<int> expected(ids.begin(), ids.end());
+    for (int id = 65536; id < 65536 + 20000; id += 3) {
+        ids.push_back(id);
+        expected.insert(id);
+    }
+    const DocumentIdSet id_set(ids);
+    ASSERT_EQUAL(id_set.size(), expected.size());
+    for (int id : {-1, 0, 3, 4, 7, 65535, 65536, 65537, 65539, 85534, 85535, 1 << 30, (1 << 30) + 1, std::numeric_limits<int>::max()}) {
+        ASSERT_EQUAL_HINT(id_set.Contains(id), expected.count(id) > 0, std::to_string(id));
+    }
+    for (const auto& [begin, end] : std::vector<std::pair<int64_t, int64_t>>{{-5, 10}, {4, 65600}, {65500, 70000}, {65601, 65663},
+        {65664, 65729}, {0, int64_t{1} << 31}, {10, 10}}) {
+        std::vector<int> found;
+        id_set.ForEachInRange(begin, end, [&found](int id) {
+            found.push_back(id);
+        });
+        const std::vector<int> expected_found(expected.lower_bound(std::max<int64_t>(begin, 0)),
+            end > std::numeric_limits<int>::max() ? expected.end() : expected.lower_bound(end));
+        ASSERT(found == expected_found);
+    }
+    ASSERT(DocumentIdSet().empty());
+
+    SearchServer search_server;
+    for (int id = 0; id < 30000; ++id) {
+        search_server.AddDocument(id, id % 3 == 0 ? "cat dog"s : (id % 3 == 1 ? "cat"s : "cat bird"s), DocumentStatus::ACTUAL, {id % 7});
+    }
+    const auto docs = search_server.FindTopDocuments("cat -dog"s, DocumentStatus::ACTUAL, 30000);
+    ASSERT_EQUAL(docs.size(), 20000u);
+    ASSERT(std::none_of(docs.begin(), docs.end(), [](const Document& doc) { return doc.id % 3 == 0; }));
+    const auto top_docs = search_server.FindTopDocuments("cat bird -dog"s);
+    ASSERT_EQUAL(top_docs.size(), 5u);
+    ASSERT(std::all_of(top_docs.begin(), top_docs.end(), [](const Document& doc) { return doc.id % 3 == 2; }));
+}
+
+void TestStatusDocuments() {
+    DocumentIdSet id_set;
+    for (int id = 0; id < 10000; id += 2) {
+        ASSERT(id_set.Insert(id));
+    }
+    ASSERT(!id_set.Insert(4));
+    ASSERT_EQUAL(id_set.size(), 5000u);
+    for (int id = 0; id < 10000; id += 4) {
+        ASSERT(id_set.Erase(id));
+    }
+    ASSERT(!id_set.Erase(4));
+    ASSERT(!id_set.Erase(-1));
+    ASSERT_EQUAL(id_set.size(), 2500u);
+    for (int id : {0, 1, 2, 4, 6, 9998, 10000}) {
+        ASSERT_EQUAL_HINT(id_set.Contains(id), id % 4 == 2 && id < 10000, std::to_string(id));
+    }
+    for (int id = 2; id < 10000; id += 4) {
+        id_set.Erase(id);
+    }
+    ASSERT(id_set.empty());
+    ASSERT(!id_set.Contains(2));
+
+    //status queries use the per status id sets, a predicate query goes through every matched document
+    SearchServer search_server;
+    for (int id = 0; id < 3000; ++id) {
+        const std::string text = "cat"s + (id % 5 == 0 ? " dog"s : ""s) + (id % 7 == 0 ? " bird"s : ""s);
+        search_server.AddDocument(id, text, static_cast<DocumentStatus>(id % 3), {id % 11});
+    }
+    for (int id = 0; id < 3000; id += 4) {
+        search_server.RemoveDocument(id);
+    }
+    search_server.AddDocument(4, "cat dog"s, DocumentStatus::REMOVED, {1});
+    for (DocumentStatus status : {DocumentStatus::ACTUAL, DocumentStatus::IRRELEVANT, DocumentStatus::BANNED, DocumentStatus::REMOVED}) {
+        const auto has_status = [status](int, DocumentStatus document_status, int) { return document_status == status; };
+        for (const std::string& query : {"cat"s, "cat dog"s, "dog bird -cat"s, "bird dog -bird"s}) {
+            for (int count : {1, 5, 3000}) {
+                const auto docs = search_server.FindTopDocuments(query, status, count);
+                const auto predicate_docs = search_server.FindTopDocuments(query, has_status, count);
+                ASSERT_EQUAL(docs.size(), predicate_docs.size());
+                for (size_t i = 0; i < docs.size(); ++i) {
+                    ASSERT_EQUAL(docs[i].id, predicate_docs[i].id);
+                    ASSERT_EQUAL(docs[i].rating, predicate_docs[i].rating);
+                    ASSERT(docs[i].status == status);
+                }
+            }
+        }
+    }
+    const auto removed_docs = search_server.FindTopDocuments("dog"s, DocumentStatus::REMOVED);
+    ASSERT_EQUAL(removed_docs.size(), 1u);
+    ASSERT_EQUAL(removed_docs[0].id, 4);
+}
+
+//a status query must not walk the status set around every posting of a rare word
+void TestRareWordStatusQuery() {
+    const int document_count = 200000;
+    std::vector<std::string> texts(document_count);
+    std::vector<DocumentToAdd> documents;
+    documents.reserve(document_count);
+    for (int id = 0; id < document_count; ++id) {
+        texts[id] = id % 2000 == 0 ? "common rare"s : "common word"s;
+        documents.push_back({id, texts[id], id % 50 == 1 ? DocumentStatus::BANNED : DocumentStatus::ACTUAL, {1}});
+    }
+    SearchServer search_server;
+    search_server.AddDocuments(std::execution::par, documents);
+
+    const auto status_docs = search_server.FindTopDocuments("rare"s, DocumentStatus::ACTUAL, 1000);
+    const auto predicate_docs = search_server.FindTopDocuments("rare"s, [](int, DocumentStatus status, int) {
+        return status == DocumentStatus::ACTUAL;
+    }, 1000);
+    ASSERT_EQUAL(status_docs.size(), static_cast<size_t>(document_count / 2000));
+    ASSERT_EQUAL(status_docs.size(), predicate_docs.size());
+
+    //best of several runs, the status path may be a few times slower than the predicate path, not hundreds
+    const auto best_time = [](auto query) {
+        auto best = std::chrono::steady_clock::duration::max();
+        for (int run = 0; run < 20; ++run) {
+            const auto start = std::chrono::steady_clock::now();
+            query();
+            best = std::min(best, std::chrono::steady_clock::now() - start);
+        }
+        return best;
+    };
+    const auto status_time = best_time([&search_server]() {
+        return search_server.FindTopDocuments("rare"s, DocumentStatus::ACTUAL, 1000);
+    });
+    const auto predicate_time = best_time([&search_server]() {
+        return search_server.FindTopDocuments("rare"s, [](int, DocumentStatus status, int) {
+            return status == DocumentStatus::ACTUAL;
+        }, 1000);
+    });
+    ASSERT_HINT(status_time < 5 * predicate_time + std::chrono::microseconds(50),
+        std::to_string(std::chrono::duration_cast<std::chrono::microseconds>(status_time).count()) + " us with the status, "s
+        + std::to_string(std::chrono::duration_cast<std::chrono::microseconds>(predicate_time).count()) + " us with a predicate"s);
+
+    const std::vector<std::string> queries = {"rare"s};
+    ASSERT_EQUAL(search_server.FindTopDocumentsBatch(std::execution::seq, queries, DocumentStatus::ACTUAL, 1000)[0].size(), status_docs.size());
+    const auto batch_time = best_time([&search_server, &queries]() {
+        return search_server.FindTopDocumentsBatch(std::execution::seq, queries, DocumentStatus::ACTUAL, 1000);
+    });
+    ASSERT_HINT(batch_time < 5 * predicate_time + std::chrono::microseconds(50),
+        std::to_string(std::chrono::duration_cast<std::chrono::microseconds>(batch_time).count()) + " us in a batch, "s
+        + std::to_string(std::chrono::duration_cast<std::chrono::microseconds>(predicate_time).count()) + " us with a predicate"s);
+}
+
+void TestTextArena() {
+    TextArena arena;
+    const std::string_view first = arena.Add("white cat"sv);
+    const std::string_view second = arena.Add("black dog"sv);
+    ASSERT_EQUAL(first, "white cat"sv);
+    ASSERT_EQUAL(second, "black dog"sv);
+    ASSERT(first.data() + first.size() == second.data());
+    ASSERT(arena.Contains(second.data()));
+    arena.Release(first);
+    ASSERT_EQUAL(arena.GetLiveSize(), second.size());
+    ASSERT_EQUAL(arena.GetDeadSize(), first.size());
+    arena.Release(second);
+    ASSERT_EQUAL(arena.GetLiveSize(), 0u);
+    ASSERT_EQUAL(arena.GetDeadSize(), 0u);
+
+    //removals compact the texts, the words of the remaining documents must follow them
+    SearchServer search_server;
+    const int document_count = 20000;
+    for (int id = 0; id < document_count; ++id) {
+        const std::string text = "cat"s + std::to_string(id) + " tail x"s + std::string(id % 50, 'a');
+        search_server.AddDocument(id, text, DocumentStatus::ACTUAL, {id});
+    }
+    for (int id = 0; id < document_count; ++id) {
+        if (id % 10 != 0) {
+            search_server.RemoveDocument(id);
+        }
+    }
+    search_server.CompactIndex();
+    ASSERT_EQUAL(search_server.GetDocumentCount(), document_count / 10);
+    for (int id = 0; id < document_count; id += 10) {
+        const std::string word = "cat"s + std::to_string(id);
+        const std::string query = word + " tail"s;
+        const auto [words, status] = search_server.MatchDocument(query, id);
+        ASSERT_EQUAL(words.size(), 2u);
+        ASSERT_EQUAL(words[0], word);
+        const auto docs = search_server.FindTopDocuments(word);
+        ASSERT_EQUAL(docs.size(), 1u);
+        ASSERT_EQUAL(docs[0].id, id);
+    }
+    ASSERT_EQUAL(search_server.FindTopDocuments("tail"s, DocumentStatus::ACTUAL, document_count).size(),
+        static_cast<size_t>(document_count / 10));
+
+    //a copy owns its texts and outlives the original
+    std::optional<SearchServer> original(std::in_place, "x"s);
+    original->AddDocument(1, "white cat"s, DocumentStatus::ACTUAL, {1});
+    original->AddDocument(2, "black dog x"s, DocumentStatus::ACTUAL, {2});
+    SearchServer copied_server = *original;
+    search_server = *original;
+    original.reset();
+    for (const SearchServer* server : {&copied_server, &search_server}) {
+        ASSERT_EQUAL(server->GetDocumentCount(), 2);
+        ASSERT_EQUAL(std::get<0>(server->MatchDocument("dog x"s, 2)), (std::vector<std::string_view>{"dog"sv}));
+        ASSERT_EQUAL(server->FindTopDocuments("cat"s).size(), 1u);
+    }
+    copied_server.AddDocument(3, "white dog"s, DocumentStatus::ACTUAL, {3});
+    ASSERT_EQUAL(copied_server.FindTopDocuments("white"s).size(), 2u);
+    ASSERT_EQUAL(search_server.FindTopDocuments("white"s).size(), 1u);
+}
+
+void TestWordSplitter() {
+    ASSERT(SplitIntoWords(""sv).empty());
+    ASSERT(SplitIntoWords("     "sv).empty());
+    ASSERT_EQUAL(SplitIntoWords("  white  cat "sv), (std::vector<std::string_view>{"white"sv, "cat"sv}));
+
+    //texts long enough for the vector blocks, with words and space runs crossing block borders
+    std::mt19937 generator(7);
+    const std::string alphabet = "  abc-\x01\x1f\x7f\x80\xff"s;
+    for (int test = 0; test < 2000; ++test) {
+        std::string text(generator() % 150, ' ');
+        for (char& c : text) {
+            c = generator() % 3 == 0 ? ' ' : alphabet[generator() % alphabet.size()];
+        }
+        std::vector<std::string_view> expected_words;
+        std::vector<bool> expected_special_symbols;
+        for (size_t pos = 0; pos < text.size();) {
+            if (text[pos] == ' ') {
+                ++pos;
+                continue;
+            }
+            const size_t end = std::min(text.find(' ', pos), text.size());
+            const std::string_view word = std::string_view(text).substr(pos, end - pos);
+            expected_words.push_back(word);
+            expected_special_symbols.push_back(std::any_of(word.begin(), word.end(), [](char c) {
+                return c >= 0 && c <= 31;
+            }));
+            pos = end;
+        }
+        const WordSplitter words(text);
+        size_t i = 0;
+        for (auto it = words.begin(); it != words.end(); ++it, ++i) {
+            ASSERT(i < expected_words.size());
+            ASSERT(it->data() == expected_words[i].data());
+            ASSERT_EQUAL(*it, expected_words[i]);
+            ASSERT_EQUAL(it.HasSpecialSymbols(), expected_special_symbols[i]);
+        }
+        ASSERT_EQUAL(i, expected_words.size());
+        ASSERT_EQUAL(HasSpecialSymbols(text), std::count(expected_special_symbols.begin(), expected_special_symbols.end(), true) > 0);
+    }
+}
+
+void TestStopWordSet() {
+    std::vector<std::string> words;
+    for (int i = 0; i < 5000; ++i) {
+        words.push_back("stop"s + std::to_string(i * 3));
+    }
+    words.push_back("stop0"s);
+    words.push_back(""s);
+    words.push_back(std::string(100, 'x'));
+    const StopWordSet stop_words(words);
+    ASSERT_EQUAL(stop_words.size(), 5001u);
+    for (int i = 0; i < 15000; ++i) {
+        ASSERT_EQUAL_HINT(stop_words.Contains("stop"s + std::to_string(i)), i % 3 == 0, std::to_string(i));
+    }
+    ASSERT(stop_words.Contains(std::string(100, 'x')));
+    ASSERT(!stop_words.Contains(std::string(101, 'x')));
+    ASSERT(!stop_words.Contains(""sv));
+    ASSERT(!stop_words.Contains("top0"sv));
+    ASSERT(!StopWordSet().Contains("stop0"sv));
+
+    SearchServer search_server(words);
+    search_server.AddDocument(1, "stop3 stop4 cat"sv, DocumentStatus::ACTUAL, {1});
+    ASSERT_EQUAL(search_server.GetWordFrequencies(1).size(), 2u);
+    ASSERT(search_server.FindTopDocuments("stop3"sv).empty());
+    ASSERT_EQUAL(search_server.FindTopDocuments("stop4"sv).size(), 1u);
+}
+
+void TestTermDictionary() {
+    TermDictionary terms;
+    const TermId cat = terms.Add("cat"sv);
+    const TermId dog = terms.Add("dog"sv);
+    ASSERT(cat != dog);
+    ASSERT_EQUAL(terms.Add("cat"sv), cat);
+    ASSERT_EQUAL(terms.GetText(dog), "dog"sv);
+    ASSERT(!terms.Find("bird"sv));
+    terms.Remove(cat);
+    ASSERT(!terms.Find("cat"sv));
+    //the id of a removed term is reused, so ids stay dense
+    ASSERT_EQUAL(terms.Add("bird"sv), cat);
+    ASSERT_EQUAL(terms.GetIdLimit(), 2u);
+
+    //removals don't move the texts of the other terms, new terms reuse the space of removed ones
+    std::vector<TermId> ids;
+    for (int i = 0; i < 200000; ++i) {
+        ids.push_back(terms.Add("word"s + std::to_string(i)));
+    }
+    const std::string_view first_text = terms.GetText(ids[0]);
+    const char* last_removed_data = terms.GetText(ids[199999]).data();
+    for (int i = 0; i < 200000; ++i) {
+        if (i % 10 != 0) {
+            terms.Remove(ids[i]);
+        }
+    }
+    ASSERT_EQUAL(terms.size(), 20002u);
+    for (int i = 0; i < 200000; i += 10) {
+        const std::string word = "word"s + std::to_string(i);
+        ASSERT_EQUAL(terms.GetText(ids[i]), word);
+        ASSERT_EQUAL(*terms.Find(word), ids[i]);
+    }
+    ASSERT(terms.GetText(ids[0]).data() == first_text.data());
+    ASSERT(terms.GetText(terms.Add("fresh12345"sv)).data() == last_removed_data);
+
+    //terms of removed documents leave the index, and their ids are given to new words
+    SearchServer search_server;
+    for (int id = 0; id < 1000; ++id) {
+        search_server.AddDocument(id, "cat word"s + std::to_string(id), DocumentStatus::ACTUAL, {id});
+    }
+    //views returned for a document stay valid while other documents are removed
+    const auto [matched_words, matched_status] = search_server.MatchDocument("cat word999"sv, 999);
+    const std::map<std::string_view, double> word_freqs = search_server.GetWordFrequencies(999);
+    for (int id = 0; id < 1000; id += 2) {
+        search_server.RemoveDocument(id);
+    }
+    ASSERT_EQUAL(matched_words, (std::vector<std::string_view>{"cat"sv, "word999"sv}));
+    ASSERT(matched_words == std::get<0>(search_server.MatchDocument("cat word999"sv, 999)));
+    ASSERT(word_freqs.begin()->first.data() == search_server.GetWordFrequencies(999).begin()->first.data());
+    for (int id = 1000; id < 1500; ++id) {
+        search_server.AddDocument(id, "dog word"s + std::to_string(id), DocumentStatus::ACTUAL, {id});
+    }
+    const auto word_to_freqs = search_server.GetWordToFreqs();
+    ASSERT_EQUAL(word_to_freqs.size(), 1002u);
+    ASSERT_EQUAL(word_to_freqs.count("word0"sv), 0u);
+    ASSERT_EQUAL(word_to_freqs.at("word1"sv).size(), 1u);
+    ASSERT_EQUAL(word_to_freqs.at("cat"sv).size(), 500u);
+    for (int id = 1; id < 1500; id += 2) {
+        const std::string query = "word"s + std::to_string(id) + " word"s + std::to_string(id - 1);
+        const auto [words, status] = search_server.MatchDocument(query, id);
+        ASSERT_EQUAL(words.size(), 1u);
+        ASSERT_EQUAL(words[0], "word"s + std::to_string(id));
+        const auto docs = search_server.FindTopDocuments(query);
+        ASSERT_EQUAL(docs.size(), id < 1000 ? 1u : 2u);
+    }
+}
+
+void TestDocumentOrdinals() {
+    SearchServer search_server;
+    const std::vector<int> ids = {1000000000, 7, 500000, 3, 42};
+    for (size_t i = 0; i < ids.size(); ++i) {
+        search_server.AddDocument(ids[i], "cat word"s + std::to_string(i), DocumentStatus::ACTUAL, {static_cast<int>(i)});
+    }
+    search_server.RemoveDocument(7);
+    search_server.RemoveDocument(500000);
+    //the new documents take the ordinals of the removed ones
+    search_server.AddDocument(1, "cat dog"s, DocumentStatus::BANNED, {10});
+    search_server.AddDocument(2000000000, "cat dog"s, DocumentStatus::ACTUAL, {20});
+    ASSERT((std::vector<int>(search_server.begin(), search_server.end()) == std::vector<int>{1, 3, 42, 1000000000, 2000000000}));
+
+    std::set<int> seen_ids;
+    const auto docs = search_server.FindTopDocuments("cat"sv, [&seen_ids](int document_id, DocumentStatus, int rating) {
+        seen_ids.insert(document_id);
+        return rating < 15;
+    }, 10);
+    ASSERT((seen_ids == std::set<int>{1, 3, 42, 1000000000, 2000000000}));
+    ASSERT_EQUAL(docs.size(), 4u);
+    ASSERT_EQUAL(docs[0].id, 1);
+    ASSERT_EQUAL(docs[0].rating, 10);
+    ASSERT(docs[0].status == DocumentStatus::BANNED);
+    const auto banned_docs = search_server.FindTopDocuments("dog"sv, DocumentStatus::BANNED);
+    ASSERT_EQUAL(banned_docs.size(), 1u);
+    ASSERT_EQUAL(banned_docs[0].id, 1);
+    ASSERT_EQUAL(search_server.GetWordToFreqs().at("dog"sv).count(2000000000), 1u);
+    ASSERT_EQUAL(std::get<0>(search_server.MatchDocument("dog"sv, 2000000000)).size(), 1u);
+    ASSERT(std::get<0>(search_server.MatchDocument("dog"sv, 42)).empty());
+    try {
+        search_server.MatchDocument("dog"sv, 7);
+        ASSERT(false);
+    } catch (const std::out_of_range&) {
+    }
+}
+
+void TestTermPostings() {
+    SearchServer search_server("in the"s);
+    for (int id = 0; id < 300; ++id) {
+        const std::string text = "cat"s + (id % 3 == 0 ? " dog"s : ""s) + (id % 7 == 0 ? " bird bird"s : ""s) + " the word"s + std::to_string(id % 50);
+        search_server.AddDocument((id * 13) % 300, text, DocumentStatus::ACTUAL, {id});
+    }
+    for (int id = 0; id < 300; id += 11) {
+        search_server.RemoveDocument(id);
+    }
+
+    std::map<std::string_view, std::map<int, double>> word_to_freqs;
+    size_t term_count = 0;
+    search_server.ForEachTerm([&](const SearchServer::TermPostings& postings) {
+        ++term_count;
+        auto& document_freqs = word_to_freqs[postings.GetWord()];
+        postings.ForEach([&document_freqs](int document_id, double term_freq) {
+            ASSERT(document_freqs.emplace(document_id, term_freq).second);
+        });
+        ASSERT_EQUAL(document_freqs.size(), postings.size());
+    });
+    ASSERT_EQUAL(term_count, search_server.GetTermCount());
+    ASSERT(word_to_freqs == search_server.GetWordToFreqs());
+
+    const auto bird = search_server.FindTerm("bird"sv);
+    ASSERT(bird.has_value());
+    ASSERT_EQUAL(bird->GetWord(), "bird"sv);
+    ASSERT_EQUAL(bird->size(), word_to_freqs.at("bird"sv).size());
+    ASSERT(!search_server.FindTerm("the"sv));
+    ASSERT(!search_server.FindTerm("fish"sv));
+
+    VersionedSearchServer versioned_server;
+    versioned_server.AddDocument(1, "white cat"sv, DocumentStatus::ACTUAL, {1});
+    const size_t cat_count = versioned_server.Read([](const SearchServer& server) {
+        return server.FindTerm("cat"sv)->size();
+    });
+    ASSERT_EQUAL(cat_count, 1u);
+}
+
+void TestConcurrentMap() {
+    ConcurrentMap<int, int> counters(16, 1000);
+    std::vector<std::thread> threads;
+    for (int t = 0; t < 4; ++t) {
+        threads.emplace_back([&counters, t]() {
+            for (int i = 0; i < 20000; ++i) {
+                if (i % 2 == 0) {
+                    counters[i % 1000].ref_to_value += 1;
+                } else {
+                    counters.Add(i % 1000, 1);
+                }
+            }
+        });
+    }
+    for (std::thread& thread : threads) {
+        thread.join();
+    }
+    ASSERT_EQUAL(counters.size(), 1000u);
+    const auto ordinary_map = counters.BuildOrdinaryMap();
+    ASSERT_EQUAL(ordinary_map.size(), 1000u);
+    const auto sorted = counters.ExtractSorted();
+    ASSERT_EQUAL(sorted.size(), 1000u);
+    for (int key = 0; key < 1000; ++key) {
+        ASSERT_EQUAL(sorted[key].first, key);
+        ASSERT_EQUAL(sorted[key].second, 80);
+        ASSERT_EQUAL(ordinary_map.at(key), 80);
+    }
+    ASSERT_EQUAL(counters.size(), 0u);
+
+    //identity hashes of strided keys differ only in the high bits
+    ConcurrentMap<int, int> strided(2);
+    for (int i = 0; i < 100000; ++i) {
+        strided.Add(i * 1024, i);
+    }
+    ASSERT_EQUAL(strided.size(), 100000u);
+    const auto strided_map = strided.BuildOrdinaryMap();
+    ASSERT_EQUAL(strided_map.at(1024 * 777), 777);
+
+    ConcurrentMap<std::string, std::string> words(3);
+    words["cat"s].ref_to_value = "white"s;
+    words["dog"s].ref_to_value += "black"s;
+    ASSERT_EQUAL(words["cat"s].ref_to_value, "white"s);
+    ASSERT((words.BuildOrdinaryMap() == std::map<std::string, std::string>{{"cat"s, "white"s}, {"dog"s, "black"s}}));
+}
+
+void TestThreadPool() {
+    ThreadPoolOptions options;
+    options.thread_count = 3;
+    ThreadPool pool(options);
+    ASSERT_EQUAL(pool.GetThreadCount(), 3u);
+    ASSERT(!pool.IsWorkerThread());
+
+    std::vector<int> calls(10000);
+    pool.ParallelFor(calls.size(), [&calls](size_t i) {
+        ++calls[i];
+    });
+    ASSERT(std::all_of(calls.begin(), calls.end(), [](int count) {
+        return count == 1;
+    }));
+
+    //nested loops are run by the waiting threads too, so they finish even when every worker waits
+    std::atomic<int> nested_calls = 0;
+    pool.ParallelFor(16, [&](size_t) {
+        pool.ParallelFor(100, [&](size_t) {
+            ++nested_calls;
+        });
+    });
+    ASSERT_EQUAL(nested_calls.load(), 1600);
+
+    try {
+        pool.ParallelFor(100, [](size_t i) {
+            if (i == 42) {
+                throw std::out_of_range("42"s);
+            }
+        });
+        ASSERT_HINT(false, "Exception of a task must be rethrown"s);
+    } catch (const std::out_of_range& e) {
+        ASSERT_EQUAL(std::string(e.what()), "42"s);
+    }
+
+    std::vector<int> numbers(100000);
+    std::mt19937 generator(7);
+    for (int& number : numbers) {
+        number = generator() % 1000;
+    }
+    std::vector<int> expected_numbers = numbers;
+    std::sort(expected_numbers.begin(), expected_numbers.end());
+    ParallelSort(ThreadPoolPolicy(pool), numbers.begin(), numbers.end(), std::less<int>());
+    ASSERT(numbers == expected_numbers);
+
+    options.nested_parallelism = false;
+    ThreadPool flat_pool(options);
+    std::atomic<int> inline_loops = 0;
+    flat_pool.ParallelFor(8, [&](size_t) {
+        ASSERT_EQUAL(flat_pool.GetParallelism(), 1u);
+        const std::thread::id id = std::this_thread::get_id();
+        bool same_thread = true;
+        flat_pool.ParallelFor(50, [&](size_t) {
+            same_thread = same_thread && std::this_thread::get_id() == id;
+        });
+        inline_loops += same_thread;
+    });
+    ASSERT_EQUAL(inline_loops.load(), 8);
+
+    try {
+        ThreadPoolOptions bad_options;
+        bad_options.thread_count = 2;
+        bad_options.cpus = {-1};
+        ThreadPool bad_pool(bad_options);
+        ASSERT_HINT(false, "Negative CPU index must be rejected"s);
+    } catch (const std::invalid_argument&) {
+    }
+
+    const ThreadPoolPolicy policy(pool);
+    SearchServer server("and in"s);
+    SearchServer expected_server("and in"s);
+    std::vector<DocumentToAdd> documents;
+    std::vector<std::string> texts;
+    const std::vector<std::string> words = {"white"s, "cat"s, "dog"s, "fluffy"s, "tail"s, "collar"s, "and"s, "in"s};
+    for (int i = 0; i < 5000; ++i) {
+        texts.push_back(words[i % 8] + " "s + words[(i / 8) % 8] + " "s + words[(i * 7) % 8]);
+    }
+    for (int i = 0; i < 5000; ++i) {
+        documents.push_back({i, texts[i], DocumentStatus::ACTUAL, {i % 10}});
+        expected_server.AddDocument(i, texts[i], DocumentStatus::ACTUAL, {i % 10});
+    }
+    server.AddDocuments(policy, documents);
+    ASSERT(server.GetWordToFreqs() == expected_server.GetWordToFreqs());
+
+    const std::vector<std::string> queries = {"white cat"s, "fluffy -dog"s, "collar tail -white"s};
+    const auto results = ProcessQueries(policy, server, queries);
+    for (size_t q = 0; q < queries.size(); ++q) {
+        const auto expected_docs = expected_server.FindTopDocuments(queries[q]);
+        ASSERT_EQUAL(results[q].size(), expected_docs.size());
+        for (size_t i = 0; i < expected_docs.size(); ++i) {
+            ASSERT_EQUAL(results[q][i].id, expected_docs[i].id);
+            ASSERT(std::abs(results[q][i].relevance - expected_docs[i].relevance) < RELEVANCE_THRESHOLD);
+        }
+    }
+
+    const std::string query = "cat tail white -collar"s;
+    ASSERT(server.MatchDocument(policy, query, 9) == expected_server.MatchDocument(query, 9));
+    server.RemoveDocument(policy, 9);
+    expected_server.RemoveDocument(9);
+    ASSERT(server.GetWordToFreqs() == expected_server.GetWordToFreqs());
+}
+
+void TestBatchQueries() {
+    const std::vector<std::string> words = {"white"s, "cat"s, "dog"s, "fluffy"s, "tail"s, "collar"s, "and"s, "in"s,
+        "bird"s, "fish"s, "groomed"s, "eyes"s};
+    std::mt19937 generator(11);
+    std::vector<std::string> texts;
+    for (int i = 0; i < 20000; ++i) {
+        std::string text;
+        for (int j = 0; j < 1 + i % 7; ++j) {
+            text += words[generator() % words.size()] + " "s;
+        }
+        texts.push_back(text);
+    }
+    SearchServer server("and in"s);
+    for (int i = 0; i < 20000; ++i) {
+        server.AddDocument(i * 3, texts[i], static_cast<DocumentStatus>(i % 3), {i % 11, i % 5});
+    }
+    server.RemoveDocument(30);
+
+    std::vector<std::string> queries = {"cat cat fluffy -dog"s, "in and"s, "unknown -cat"s, ""s, "bird -bird"s};
+    for (int q = 0; q < 200; ++q) {
+        std::string query;
+        for (int j = 0; j < 1 + q % 4; ++j) {
+            query += (generator() % 5 == 0 ? "-"s : ""s) + words[generator() % words.size()] + " "s;
+        }
+        queries.push_back(query);
+    }
+
+    const auto expect_same = [](const std::vector<std::vector<Document>>& results, const std::vector<std::vector<Document>>& expected) {
+        ASSERT_EQUAL(results.size(), expected.size());
+        for (size_t q = 0; q < expected.size(); ++q) {
+            ASSERT_EQUAL(results[q].size(), expected[q].size());
+            for (size_t i = 0; i < expected[q].size(); ++i) {
+                ASSERT_EQUAL(results[q][i].id, expected[q][i].id);
+                ASSERT_EQUAL(results[q][i].rating, expected[q][i].rating);
+                ASSERT(results[q][i].relevance == expected[q][i].relevance);
+            }
+        }
+    };
+
+    const auto expected = ProcessQueries(server, queries);
+    expect_same(ProcessQueriesBatched(server, queries), expected);
+    expect_same(server.FindTopDocumentsBatch(std::execution::seq, queries), expected);
+    expect_same(server.FindTopDocumentsBatch(std::execution::par, queries), expected);
+
+    std::vector<std::vector<Document>> banned;
+    for (const std::string& query : queries) {
+        banned.push_back(server.FindTopDocuments(query, DocumentStatus::BANNED, 50));
+    }
+    expect_same(server.FindTopDocumentsBatch(std::execution::par, queries, DocumentStatus::BANNED, 50), banned);
+
+    const auto joined = ProcessQueriesBatchedJoined(server, queries);
+    const auto expected_joined = ProcessQueriesJoined(server, queries);
+    ASSERT_EQUAL(joined.size(), expected_joined.size());
+    for (size_t i = 0; i < joined.size(); ++i) {
+        ASSERT_EQUAL(joined[i].id, expected_joined[i].id);
+    }
+
+    try {
+        server.FindTopDocumentsBatch(std::execution::seq, {"cat"s, "--dog"s});
+        ASSERT_HINT(false, "Invalid query must be rejected"s);
+    } catch (const std::invalid_argument&) {
+    }
+}
+
+void TestAsyncSearchServer() {
+    SearchServer server("and in"s);
+    server.AddDocument(1, "white cat and fluffy tail"s, DocumentStatus::ACTUAL, {8});
+    server.AddDocument(2, "black dog in collar"s, DocumentStatus::ACTUAL, {3});
+    server.AddDocument(3, "fluffy dog"s, DocumentStatus::BANNED, {5});
+    const std::vector<std::string> queries = {"fluffy cat"s, "dog"s, "collar -black"s, "tail dog"s};
+
+    AsyncSearchStats stats;
+    {
+        AsyncSearchOptions options;
+        options.worker_count = 2;
+        AsyncSearchServer async_server(server, options);
+        ASSERT_EQUAL(async_server.GetWorkerCount(), 2u);
+
+        std::vector<std::future<std::vector<Document>>> futures;
+        for (const std::string& query : queries) {
+            futures.push_back(async_server.Submit(query));
+        }
+        futures.push_back(async_server.Submit("dog"s, DocumentStatus::BANNED, 1, AsyncSearchServer::Clock::now() + std::chrono::hours(1)));
+        for (size_t i = 0; i < queries.size(); ++i) {
+            const auto documents = futures[i].get();
+            const auto expected = server.FindTopDocuments(queries[i]);
+            ASSERT_EQUAL(documents.size(), expected.size());
+            for (size_t j = 0; j < documents.size(); ++j) {
+                ASSERT_EQUAL(documents[j].id, expected[j].id);
+            }
+        }
+        const auto banned = futures.back().get();
+        ASSERT_EQUAL(banned.size(), 1u);
+        ASSERT_EQUAL(banned[0].id, 3);
+
+        auto invalid = async_server.Submit("--dog"s);
+        try {
+            invalid.get();
+            ASSERT_HINT(false, "Invalid query must fail"s);
+        } catch (const std::invalid_argument&) {
+        }
+
+        auto expired = async_server.Submit("dog"s, AsyncSearchServer::Clock::now() - std::chrono::milliseconds(1));
+        try {
+            expired.get();
+            ASSERT_HINT(false, "Request past its deadline must not run"s);
+        } catch (const QueryDeadlineError&) {
+        }
+        stats = async_server.GetStats();
+    }
+    ASSERT_EQUAL(stats.accepted, 7u);
+    ASSERT_EQUAL(stats.completed, 6u);
+    ASSERT_EQUAL(stats.failed, 1u);
+    ASSERT_EQUAL(stats.expired, 1u);
+    ASSERT_EQUAL(stats.rejected, 0u);
+    ASSERT_EQUAL(stats.queue_depth, 0u);
+    ASSERT(stats.max_queue_depth >= 1u);
+    ASSERT(stats.max_wait_time <= stats.total_wait_time);
+
+    AsyncSearchOptions no_queue_options;
+    no_queue_options.worker_count = 1;
+    no_queue_options.max_queue_size = 0;
+    AsyncSearchServer overloaded_server(server, no_queue_options);
+    auto rejected = overloaded_server.Submit("dog"s);
+    ASSERT(rejected.wait_for(std::chrono::seconds(0)) == std::future_status::ready);
+    try {
+        rejected.get();
+        ASSERT_HINT(false, "Request over the queue limit must be rejected"s);
+    } catch (const QueryRejectedError& error) {
+        ASSERT_EQUAL(std::string(error.what()), "Search queue is full"s);
+    }
+    ASSERT_EQUAL(overloaded_server.GetStats().rejected, 1u);
+    ASSERT_EQUAL(overloaded_server.GetStats().accepted, 0u);
+}
+
+void TestJoinedQueryResults() {
+    SearchServer server("and in"s);
+    for (int i = 0; i < 200; ++i) {
+        server.AddDocument(i, (i % 2 == 0 ? "white cat "s : "black dog "s) + (i % 3 == 0 ? "fluffy tail"s : "collar"s),
+            DocumentStatus::ACTUAL, {i % 7});
+    }
+    std::vector<std::string> queries;
+    for (int q = 0; q < 50; ++q) {
+        queries.push_back(q % 5 == 0 ? "unknown"s : (q % 2 == 0 ? "cat -collar"s : "dog collar tail"s));
+    }
+
+    const auto expected = ProcessQueriesJoined(server, queries);
+    std::vector<int> ids;
+    for (const Document& document : ProcessQueriesJoinedLazy(server, queries)) {
+        ids.push_back(document.id);
+    }
+    ThreadPoolOptions options;
+    options.thread_count = 2;
+    ThreadPool pool(options);
+    JoinedQueryResults chunked(ThreadPoolPolicy(pool), server, queries, 3);
+    std::vector<int> chunked_ids;
+    for (auto it = chunked.begin(); it != chunked.end(); ++it) {
+        chunked_ids.push_back(it->id);
+    }
+    JoinedQueryResults post_incremented(ThreadPoolPolicy(pool), server, queries, 3);
+    std::vector<int> post_incremented_ids;
+    for (auto it = post_incremented.begin(); it != post_incremented.end();) {
+        post_incremented_ids.push_back((*it++).id);
+    }
+    ASSERT_EQUAL(ids.size(), expected.size());
+    ASSERT(ids == chunked_ids);
+    ASSERT(ids == post_incremented_ids);
+
+    //begin doesn't restart or skip chunks, it continues from the current document
+    JoinedQueryResults resumed(ThreadPoolPolicy(pool), server, queries, 3);
+    std::vector<int> resumed_ids;
+    ASSERT(resumed.begin() == resumed.begin());
+    for (auto it = resumed.begin(); it != resumed.end() && resumed_ids.size() < 7; ++it) {
+        resumed_ids.push_back(it->id);
+    }
+    for (auto it = resumed.begin(); it != resumed.end(); ++it) {
+        resumed_ids.push_back(it->id);
+    }
+    ASSERT(ids == resumed_ids);
+    ASSERT(resumed.begin() == resumed.end());
+    for (size_t i = 0; i < expected.size(); ++i) {
+        ASSERT_EQUAL(ids[i], expected[i].id);
+    }
+
+    const std::vector<std::string> no_queries;
+    JoinedQueryResults empty(ThreadPoolPolicy(pool), server, no_queries, 3);
+    ASSERT(empty.begin() == empty.end());
+
+    //the first chunk is readable before a later invalid query fails
+    const std::vector<std::string> bad_queries = {"cat"s, "dog"s, "tail"s, "--cat"s};
+    JoinedQueryResults bad_results(ThreadPoolPolicy(pool), server, bad_queries, 3);
+    int read_count = 0;
+    try {
+        for (auto it = bad_results.begin(); it != bad_results.end(); ++it) {
+            ++read_count;
+        }
+        ASSERT_HINT(false, "Invalid query must fail"s);
+    } catch (const std::invalid_argument&) {
+    }
+    ASSERT_EQUAL(read_count, 3 * MAX_RESULT_DOCUMENT_COUNT);
+}
+
+void TestMatchDocuments() {
+    const std::vector<std::string> texts = MakeTestTexts(300, 3);
+    SearchServer server("in the"s);
+    std::vector<int> ids;
+    for (int i = 0; i < 300; ++i) {
+        server.AddDocument(i * 2, texts[i], static_cast<DocumentStatus>(i % 3), {i % 5});
+        ids.push_back(i * 2);
+    }
+    server.RemoveDocument(10);
+    ids.erase(std::find(ids.begin(), ids.end(), 10));
+
+    const std::string path = "match_documents_test.snapshot"s;
+    server.SaveSnapshot(path);
+    {
+        const SearchServer loaded_server = SearchServer::LoadSnapshot(path);
+        ThreadPoolOptions options;
+        options.thread_count = 2;
+        ThreadPool pool(options);
+        const std::vector<std::string> queries = {"frog cat tail fish cat"s, "bird -fish dog"s, "the in"s, "unknown -cat"s, "tail -unknown"s};
+        for (const std::string& query : queries) {
+            for (const SearchServer* s : std::vector<const SearchServer*>{&server, &loaded_server}) {
+                const auto results = s->MatchDocuments(query, ids);
+                ASSERT_EQUAL(results.size(), ids.size());
+                for (size_t i = 0; i < ids.size(); ++i) {
+                    ASSERT(results[i] == s->MatchDocument(query, ids[i]));
+                }
+                ASSERT(s->MatchDocuments(std::execution::par, query, ids) == results);
+                ASSERT(s->MatchDocuments(ThreadPoolPolicy(pool), query, ids) == results);
+            }
+        }
+        try {
+            loaded_server.MatchDocuments("cat"s, {0, 10});
+            ASSERT_HINT(false, "Unknown document id must be rejected"s);
+        } catch (const std::out_of_range&) {
+        }
+    }
+    std::remove(path.c_str());
+    ASSERT(server.MatchDocuments("cat"s, {}).empty());
+}
+
 void TestSearchServer() {
     std::cout << "Module tests started!"s << std::endl;
     TestExcludeStopWordsFromAddedDocumentContent();
@@ -365,5 +1821,33 @@ void TestSearchServer() {
     TestGetWordFrequencies();
     TestRemoveDocument();
     TestRemoveDuplicate();
+    TestOutOfOrderDocuments();
+    TestRemoveDocumentOwningWordText();
+    TestMaxResultDocumentCount();
+    TestSparseDocumentIds();
+    TestInverseDocumentFreqRefresh();
+    TestPostingCodec();
+    TestCompressedIndex();
+    TestSnapshot();
+    TestAddDocuments();
+    TestShardedSearchServer();
+    TestVersionedSearchServer();
+    TestRequestQueueCache();
+    TestPrunedTopDocuments();
+    TestDocumentIdSet();
+    TestStatusDocuments();
+    TestRareWordStatusQuery();
+    TestTextArena();
+    TestWordSplitter();
+    TestStopWordSet();
+    TestTermDictionary();
+    TestDocumentOrdinals();
+    TestTermPostings();
+    TestConcurrentMap();
+    TestThreadPool();
+    TestBatchQueries();
+    TestAsyncSearchServer();
+    TestJoinedQueryResults();
+    TestMatchDocuments();
     std::cout << "Module tests completed successfully!"s << std::endl;
 }
\ No newline at end of file
@@ -26,4 +26,60 @@ void TestRemoveDocument();
 
 void TestRemoveDuplicate();
 
+void TestOutOfOrderDocuments();
+
+void TestRemoveDocumentOwningWordText();
+
+void TestMaxResultDocumentCount();
+
+void TestSparseDocumentIds();
+
+void TestInverseDocumentFreqRefresh();
+
+void TestPostingCodec();
+
+void TestCompressedIndex();
+
+void TestSnapshot();
+
+void TestAddDocuments();
+
+void TestShardedSearchServer();
+
+void TestVersionedSearchServer();
+
+void TestRequestQueueCache();
+
+void TestPrunedTopDocuments();
+
+void TestDocumentIdSet();
+
+void TestStatusDocuments();
+
+void TestRareWordStatusQuery();
+
+void TestTextArena();
+
+void TestWordSplitter();
+
+void TestStopWordSet();
+
+void TestTermDictionary();
+
+void TestDocumentOrdinals();
+
+void TestTermPostings();
+
+void TestConcurrentMap();
+
+void TestThreadPool();
+
+void TestBatchQueries();
+
+void TestAsyncSearchServer();
+
+void TestJoinedQueryResults();
+
+void TestMatchDocuments();
+
 void TestSearchServer();
\ No newline at end of file
@@ -0,0 +1,74 @@
+#include <algorithm>
+#include <cstring>
+#include <iterator>
+#include <functional>
+
+#include "text_arena.h"
+
+std::string_view TextArena::Add(std::string_view text) {
+    if (text.empty()) {
+        return {};
+    }
+    if (current_ == nullptr || current_->capacity - current_->used < text.size()) {
+        Chunk chunk;
+        chunk.capacity = std::max(TEXT_ARENA_CHUNK_SIZE, text.size());
+        chunk.data = std::make_unique<char[]>(chunk.capacity);
+        const char* data = chunk.data.get();
+        current_ = &chunks_.emplace(data, std::move(chunk)).first->second;
+    }
+    char* data = current_->data.get() + current_->used;
+    std::memcpy(data, text.data(), text.size());
+    current_->used += text.size();
+    current_->live += text.size();
+    live_size_ += text.size();
+    return {data, text.size()};
+}
+
+void TextArena::Release(std::string_view text) {
+    if (text.empty()) {
+        return;
+    }
+    const auto it = FindChunk(text.data());
+    Chunk& chunk = it->second;
+    chunk.live -= text.size();
+    live_size_ -= text.size();
+    dead_size_ += text.size();
+    if (chunk.live > 0) {
+        return;
+    }
+    dead_size_ -= chunk.used;
+    if (&chunk == current_) {
+        //the chunk is still written to, so it is reused from the start instead of freed
+        chunk.used = 0;
+        return;
+    }
+    chunks_.erase(it);
+}
+
+//the chunks are owned and writable, the view only makes their memory look const
+std::string_view TextArena::Replace(std::string_view text, std::string_view new_text) {
+    char* data = const_cast<char*>(text.data());
+    std::memcpy(data, new_text.data(), new_text.size());
+    return {data, new_text.size()};
+}
+
+bool TextArena::Contains(const char* data) const {
+    auto it = chunks_.upper_bound(data);
+    if (it == chunks_.begin()) {
+        return false;
+    }
+    --it;
+    return std::less<const char*>()(data, it->first + it->second.used);
+}
+
+size_t TextArena::GetLiveSize() const {
+    return live_size_;
+}
+
+size_t TextArena::GetDeadSize() const {
+    return dead_size_;
+}
+
+std::map<const char*, TextArena::Chunk>::iterator TextArena::FindChunk(const char* data) {
+    return std::prev(chunks_.upper_bound(data));
+}
@@ -0,0 +1,55 @@
+#pragma once
+
+#include <map>
+#include <memory>
+#include <cstddef>
+#include <string_view>
+
+static constexpr size_t TEXT_ARENA_CHUNK_SIZE = size_t{1} << 20;
+
+// Append-only storage of document texts. Texts are copied one after another into large chunks,
+// so millions of short texts don't cost an allocation each. Returned views stay valid until
+// the text is released; a chunk is freed once all its texts are released, and the space of
+// released texts in other chunks is reclaimed by copying the live texts into a new arena.
+// The arena is not copyable, owners copy their texts into a new arena and rebase the views
+class TextArena {
+public:
+    TextArena() = default;
+    TextArena(TextArena&&) = default;
+    TextArena& operator=(TextArena&&) = default;
+    TextArena(const TextArena&) = delete;
+    TextArena& operator=(const TextArena&) = delete;
+
+    std::string_view Add(std::string_view text);
+
+    // text must be a view returned by Add
+    void Release(std::string_view text);
+
+    // Writes new_text over text, a view returned by Add and not released, of the same size.
+    // Returns the view of new_text in the same place
+    std::string_view Replace(std::string_view text, std::string_view new_text);
+
+    bool Contains(const char* data) const;
+
+    // Bytes of the texts which are not released
+    size_t GetLiveSize() const;
+
+    // Bytes of the released texts which are still held by their chunks
+    size_t GetDeadSize() const;
+
+private:
+    struct Chunk {
+        std::unique_ptr<char[]> data;
+        size_t capacity = 0;
+        size_t used = 0;
+        size_t live = 0;
+    };
+
+    // chunks by the address of their data
+    std::map<const char*, Chunk> chunks_;
+    Chunk* current_ = nullptr;
+    size_t live_size_ = 0;
+    size_t dead_size_ = 0;
+
+    std::map<const char*, Chunk>::iterator FindChunk(const char* data);
+};
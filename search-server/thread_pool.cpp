@@ -0,0 +1,221 @@
+#include <stdexcept>
+#include <string>
+
+#ifdef __linux__
+#include <pthread.h>
+#include <sched.h>
+#endif
+
+#include "thread_pool.h"
+
+using namespace std::string_literals;
+
+namespace {
+
+thread_local const ThreadPool* current_pool = nullptr;
+thread_local size_t current_worker_index = 0;
+//pool whose task the thread is running, waiting threads run tasks as well as workers
+thread_local const ThreadPool* current_task_pool = nullptr;
+
+void PinThread(std::thread& thread, int cpu) {
+#ifdef __linux__
+    if (cpu < 0 || cpu >= CPU_SETSIZE) {
+        throw std::invalid_argument("Invalid CPU index: "s + std::to_string(cpu));
+    }
+    cpu_set_t cpu_set;
+    CPU_ZERO(&cpu_set);
+    CPU_SET(cpu, &cpu_set);
+    if (pthread_setaffinity_np(thread.native_handle(), sizeof(cpu_set), &cpu_set) != 0) {
+        throw std::invalid_argument("Can't pin a worker to CPU "s + std::to_string(cpu));
+    }
+#else
+    (void)thread;
+    (void)cpu;
+#endif
+}
+
+} // namespace
+
+ThreadPool::ThreadPool(ThreadPoolOptions options)
+    : options_(std::move(options)) {
+    size_t thread_count = options_.thread_count;
+    if (thread_count == 0) {
+        thread_count = std::max(1u, std::thread::hardware_concurrency());
+    }
+    workers_.reserve(thread_count);
+    try {
+        for (size_t i = 0; i < thread_count; ++i) {
+            workers_.push_back(std::make_unique<Worker>());
+            workers_.back()->thread = std::thread([this, i] {
+                WorkerLoop(i);
+            });
+            if (!options_.cpus.empty()) {
+                PinThread(workers_.back()->thread, options_.cpus[i % options_.cpus.size()]);
+            }
+        }
+    } catch (...) {
+        Stop();
+        throw;
+    }
+}
+
+ThreadPool::~ThreadPool() {
+    Stop();
+}
+
+size_t ThreadPool::GetThreadCount() const {
+    return workers_.size();
+}
+
+size_t ThreadPool::GetParallelism() const {
+    if (current_task_pool == this && !options_.nested_parallelism) {
+        return 1;
+    }
+    return workers_.size() + 1;
+}
+
+bool ThreadPool::IsWorkerThread() const {
+    return current_pool == this;
+}
+
+ThreadPool& ThreadPool::GetDefault() {
+    static ThreadPool pool;
+    return pool;
+}
+
+//a few tasks per thread let fast threads take over the work of slow ones
+void ThreadPool::Run(Job& job, size_t count) {
+    const size_t task_count = std::min(count, GetParallelism() * TASKS_PER_THREAD);
+    std::vector<Task> tasks;
+    tasks.reserve(task_count);
+    for (size_t i = 0; i < task_count; ++i) {
+        tasks.push_back({&job, count * i / task_count, count * (i + 1) / task_count});
+    }
+    job.pending_tasks = task_count;
+    Push(tasks);
+
+    //tasks of the job left in the queues are found here, the rest are being run by other threads
+    while (true) {
+        {
+            std::lock_guard lock(job.mutex);
+            if (job.pending_tasks == 0) {
+                break;
+            }
+        }
+        if (const std::optional<Task> task = TakeTask()) {
+            Execute(*task);
+            continue;
+        }
+        std::unique_lock lock(job.mutex);
+        job.done.wait(lock, [&job] {
+            return job.pending_tasks == 0;
+        });
+        break;
+    }
+    if (job.exception) {
+        std::rethrow_exception(job.exception);
+    }
+}
+
+void ThreadPool::Push(const std::vector<Task>& tasks) {
+    if (IsWorkerThread()) {
+        Worker& worker = *workers_[current_worker_index];
+        std::lock_guard lock(worker.mutex);
+        worker.tasks.insert(worker.tasks.end(), tasks.begin(), tasks.end());
+    } else {
+        std::lock_guard lock(shared_mutex_);
+        shared_tasks_.insert(shared_tasks_.end(), tasks.begin(), tasks.end());
+    }
+    queued_task_count_ += tasks.size();
+    {
+        std::lock_guard lock(sleep_mutex_);
+    }
+    wake_.notify_all();
+}
+
+//own tasks are taken from the back, the latest ones are the smallest and their data is still in the cache
+std::optional<ThreadPool::Task> ThreadPool::TakeTask() {
+    if (queued_task_count_.load() == 0) {
+        return std::nullopt;
+    }
+    const size_t self = IsWorkerThread() ? current_worker_index : workers_.size();
+    std::optional<Task> task;
+    if (self < workers_.size()) {
+        Worker& worker = *workers_[self];
+        std::lock_guard lock(worker.mutex);
+        if (!worker.tasks.empty()) {
+            task = worker.tasks.back();
+            worker.tasks.pop_back();
+        }
+    }
+    if (!task) {
+        std::lock_guard lock(shared_mutex_);
+        if (!shared_tasks_.empty()) {
+            task = shared_tasks_.front();
+            shared_tasks_.pop_front();
+        }
+    }
+    for (size_t i = 1; !task && i <= workers_.size(); ++i) {
+        Worker& victim = *workers_[(self + i) % workers_.size()];
+        std::lock_guard lock(victim.mutex);
+        if (!victim.tasks.empty()) {
+            task = victim.tasks.front();
+            victim.tasks.pop_front();
+        }
+    }
+    if (task) {
+        --queued_task_count_;
+    }
+    return task;
+}
+
+void ThreadPool::Execute(const Task& task) {
+    Job& job = *task.job;
+    std::exception_ptr exception;
+    const ThreadPool* outer_task_pool = current_task_pool;
+    current_task_pool = this;
+    try {
+        job.run(job.func, task.begin, task.end);
+    } catch (...) {
+        exception = std::current_exception();
+    }
+    current_task_pool = outer_task_pool;
+    std::lock_guard lock(job.mutex);
+    if (exception && !job.exception) {
+        job.exception = exception;
+    }
+    if (--job.pending_tasks == 0) {
+        job.done.notify_all();
+    }
+}
+
+void ThreadPool::WorkerLoop(size_t index) {
+    current_pool = this;
+    current_worker_index = index;
+    while (true) {
+        if (const std::optional<Task> task = TakeTask()) {
+            Execute(*task);
+            continue;
+        }
+        std::unique_lock lock(sleep_mutex_);
+        wake_.wait(lock, [this] {
+            return stop_ || queued_task_count_.load() > 0;
+        });
+        if (stop_ && queued_task_count_.load() == 0) {
+            return;
+        }
+    }
+}
+
+void ThreadPool::Stop() {
+    {
+        std::lock_guard lock(sleep_mutex_);
+        stop_ = true;
+    }
+    wake_.notify_all();
+    for (const std::unique_ptr<Worker>& worker : workers_) {
+        if (worker->thread.joinable()) {
+            worker->thread.join();
+        }
+    }
+}
@@ -0,0 +1,205 @@
+#pragma once
+
+#include <vector>
+#include <deque>
+#include <optional>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <atomic>
+#include <exception>
+#include <memory>
+#include <algorithm>
+#include <execution>
+#include <numeric>
+#include <type_traits>
+#include <cstddef>
+
+struct ThreadPoolOptions {
+    // 0 means one worker per hardware thread
+    size_t thread_count = 0;
+    // worker i is pinned to cpus[i % cpus.size()], the workers are not pinned if it is empty
+    std::vector<int> cpus;
+    // loops started by a task of the pool are split between the workers if true
+    // and run by the thread which started them if false
+    bool nested_parallelism = true;
+};
+
+// Work-stealing thread pool. Every worker takes tasks from the back of its own deque and
+// steals from the front of the other deques when it runs out; tasks of outside threads go
+// to a shared queue. A thread waiting for its loop runs queued tasks meanwhile, so loops
+// started inside tasks don't block workers and can't deadlock the pool
+class ThreadPool {
+public:
+    explicit ThreadPool(ThreadPoolOptions options = {});
+    ThreadPool(const ThreadPool&) = delete;
+    ThreadPool& operator=(const ThreadPool&) = delete;
+    ~ThreadPool();
+
+    size_t GetThreadCount() const;
+
+    // Number of threads a loop started by the calling thread runs on, the caller included
+    size_t GetParallelism() const;
+
+    // true if the calling thread is a worker of this pool
+    bool IsWorkerThread() const;
+
+    // Calls func(i) for every i in [0, count) and returns when all calls are done; the calling
+    // thread takes part in the work. The first exception thrown by func is rethrown at the end
+    template <typename Func>
+    void ParallelFor(size_t count, Func func);
+
+    // Sorts chunks of the range in parallel and merges them pairwise
+    template <typename RandomIt, typename Compare>
+    void Sort(RandomIt first, RandomIt last, Compare comp);
+
+    // Pool with the default options, created on the first use
+    static ThreadPool& GetDefault();
+
+private:
+    static constexpr size_t TASKS_PER_THREAD = 4;
+    static constexpr size_t MIN_SORT_CHUNK_SIZE = 4096;
+
+    struct Job {
+        void (*run)(void* func, size_t begin, size_t end);
+        void* func;
+        //guarded by mutex, the waiting thread leaves only after the last task has released it
+        size_t pending_tasks = 0;
+        std::mutex mutex;
+        std::condition_variable done;
+        std::exception_ptr exception;
+    };
+
+    struct Task {
+        Job* job;
+        size_t begin;
+        size_t end;
+    };
+
+    struct alignas(64) Worker {
+        std::mutex mutex;
+        std::deque<Task> tasks;
+        std::thread thread;
+    };
+
+    ThreadPoolOptions options_;
+    std::vector<std::unique_ptr<Worker>> workers_;
+    std::mutex shared_mutex_;
+    std::deque<Task> shared_tasks_;
+    std::atomic<size_t> queued_task_count_ = 0;
+    std::mutex sleep_mutex_;
+    std::condition_variable wake_;
+    bool stop_ = false;
+
+    void Run(Job& job, size_t count);
+
+    void Push(const std::vector<Task>& tasks);
+
+    std::optional<Task> TakeTask();
+
+    void Execute(const Task& task);
+
+    void WorkerLoop(size_t index);
+
+    void Stop();
+};
+
+// Execution policy which runs the parallel algorithms of the project on a ThreadPool.
+// It is accepted everywhere a standard execution policy is
+class ThreadPoolPolicy {
+public:
+    explicit ThreadPoolPolicy(ThreadPool& pool)
+        : pool_(&pool) {
+    }
+
+    ThreadPool& GetPool() const {
+        return *pool_;
+    }
+
+private:
+    ThreadPool* pool_;
+};
+
+template <typename ExecutionPolicy>
+inline constexpr bool IS_THREAD_POOL_POLICY = std::is_same_v<std::decay_t<ExecutionPolicy>, ThreadPoolPolicy>;
+
+// Calls func(i) for every i in [0, count) with a standard policy or on the pool of a ThreadPoolPolicy
+template <typename ExecutionPolicy, typename Func>
+void ParallelFor(const ExecutionPolicy& policy, size_t count, Func func) {
+    if constexpr (IS_THREAD_POOL_POLICY<ExecutionPolicy>) {
+        policy.GetPool().ParallelFor(count, func);
+    } else if constexpr (std::is_same_v<ExecutionPolicy, std::execution::sequenced_policy>) {
+        for (size_t i = 0; i < count; ++i) {
+            func(i);
+        }
+    } else {
+        std::vector<size_t> indexes(count);
+        std::iota(indexes.begin(), indexes.end(), 0);
+        std::for_each(policy, indexes.begin(), indexes.end(), func);
+    }
+}
+
+template <typename ExecutionPolicy, typename RandomIt, typename Compare>
+void ParallelSort(const ExecutionPolicy& policy, RandomIt first, RandomIt last, Compare comp) {
+    if constexpr (IS_THREAD_POOL_POLICY<ExecutionPolicy>) {
+        policy.GetPool().Sort(first, last, comp);
+    } else {
+        std::sort(policy, first, last, comp);
+    }
+}
+
+// Number of threads a loop with the policy runs on
+template <typename ExecutionPolicy>
+size_t GetParallelism(const ExecutionPolicy& policy) {
+    if constexpr (IS_THREAD_POOL_POLICY<ExecutionPolicy>) {
+        return policy.GetPool().GetParallelism();
+    } else if constexpr (std::is_same_v<ExecutionPolicy, std::execution::sequenced_policy>) {
+        return 1;
+    } else {
+        return std::max(1u, std::thread::hardware_concurrency());
+    }
+}
+
+template <typename Func>
+void ThreadPool::ParallelFor(size_t count, Func func) {
+    if (GetParallelism() == 1 || count <= 1) {
+        for (size_t i = 0; i < count; ++i) {
+            func(i);
+        }
+        return;
+    }
+    Job job;
+    job.run = [](void* context, size_t begin, size_t end) {
+        Func& f = *static_cast<Func*>(context);
+        for (size_t i = begin; i < end; ++i) {
+            f(i);
+        }
+    };
+    job.func = &func;
+    Run(job, count);
+}
+
+template <typename RandomIt, typename Compare>
+void ThreadPool::Sort(RandomIt first, RandomIt last, Compare comp) {
+    const size_t size = last - first;
+    const size_t chunk_count = std::min(GetParallelism(), size / MIN_SORT_CHUNK_SIZE);
+    if (chunk_count < 2) {
+        std::sort(first, last, comp);
+        return;
+    }
+    std::vector<RandomIt> bounds(chunk_count + 1);
+    for (size_t i = 0; i <= chunk_count; ++i) {
+        bounds[i] = first + size * i / chunk_count;
+    }
+    ParallelFor(chunk_count, [&](size_t i) {
+        std::sort(bounds[i], bounds[i + 1], comp);
+    });
+    for (size_t width = 1; width < chunk_count; width *= 2) {
+        ParallelFor((chunk_count + 2 * width - 1) / (2 * width), [&](size_t i) {
+            const size_t begin = 2 * width * i;
+            const size_t middle = std::min(begin + width, chunk_count);
+            const size_t end = std::min(begin + 2 * width, chunk_count);
+            std::inplace_merge(bounds[begin], bounds[middle], bounds[end], comp);
+        });
+    }
+}
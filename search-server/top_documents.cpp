@@ -0,0 +1,51 @@
+#include <algorithm>
+#include <cmath>
+#include <utility>
+#include <limits>
+
+#include "top_documents.h"
+
+bool IsMoreRelevant(const Document& lhs, const Document& rhs) {
+    if (std::abs(lhs.relevance - rhs.relevance) >= RELEVANCE_THRESHOLD) {
+        return lhs.relevance > rhs.relevance;
+    }
+    if (lhs.rating != rhs.rating) {
+        return lhs.rating > rhs.rating;
+    }
+    return lhs.id < rhs.id;
+}
+
+TopDocuments::TopDocuments(size_t max_count) : max_count_(max_count) {
+    heap_.reserve(max_count);
+}
+
+// heap_ is ordered by IsMoreRelevant, so its front is the worst kept document
+void TopDocuments::Push(const Document& document) {
+    if (heap_.size() < max_count_) {
+        heap_.push_back(document);
+        std::push_heap(heap_.begin(), heap_.end(), IsMoreRelevant);
+    } else if (max_count_ > 0 && IsMoreRelevant(document, heap_.front())) {
+        std::pop_heap(heap_.begin(), heap_.end(), IsMoreRelevant);
+        heap_.back() = document;
+        std::push_heap(heap_.begin(), heap_.end(), IsMoreRelevant);
+    }
+}
+
+void TopDocuments::Merge(TopDocuments&& other) {
+    for (const Document& document : other.heap_) {
+        Push(document);
+    }
+    other.heap_.clear();
+}
+
+double TopDocuments::GetMinRelevance() const {
+    if (heap_.size() < max_count_ || heap_.empty()) {
+        return -std::numeric_limits<double>::infinity();
+    }
+    return heap_.front().relevance;
+}
+
+std::vector<Document> TopDocuments::Extract() {
+    std::sort_heap(heap_.begin(), heap_.end(), IsMoreRelevant);
+    return std::exchange(heap_, {});
+}
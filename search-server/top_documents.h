@@ -0,0 +1,34 @@
+#pragma once
+
+#include <vector>
+#include <cstddef>
+
+#include "document.h"
+
+static constexpr double RELEVANCE_THRESHOLD = 1e-6;
+
+// Ranking order of search results: higher relevance first, documents with equal
+// (within RELEVANCE_THRESHOLD) relevance are ordered by rating, then by id
+bool IsMoreRelevant(const Document& lhs, const Document& rhs);
+
+// Keeps the best max_count documents pushed into it using a bounded heap,
+// so selecting the top of N documents costs O(N log max_count)
+class TopDocuments {
+public:
+    explicit TopDocuments(size_t max_count);
+
+    void Push(const Document& document);
+
+    void Merge(TopDocuments&& other);
+
+    // Relevance of the worst kept document once max_count documents are kept, -infinity before that.
+    // A document less relevant than that by at least RELEVANCE_THRESHOLD can't be kept
+    double GetMinRelevance() const;
+
+    // Returns the kept documents in ranking order and leaves the collector empty
+    std::vector<Document> Extract();
+
+private:
+    std::vector<Document> heap_;
+    size_t max_count_;
+};
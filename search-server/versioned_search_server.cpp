@@ -0,0 +1,50 @@
+#include <thread>
+
+#include "versioned_search_server.h"
+
+VersionedSearchServer::ReadGuard::ReadGuard(const VersionedSearchServer& server)
+    : server_(server)
+    , read_indicator_(server.read_indicator_index_.load()) {
+    ++server_.read_indicators_[read_indicator_];
+    search_server_ = &server_.servers_[server_.published_.load()];
+}
+
+VersionedSearchServer::ReadGuard::~ReadGuard() {
+    --server_.read_indicators_[read_indicator_];
+}
+
+const SearchServer& VersionedSearchServer::ReadGuard::GetServer() const {
+    return *search_server_;
+}
+
+int VersionedSearchServer::GetDocumentCount() const {
+    return Read([](const SearchServer& server) {
+        return server.GetDocumentCount();
+    });
+}
+
+void VersionedSearchServer::AddDocument(int document_id, std::string_view document, DocumentStatus status, const std::vector<int>& ratings) {
+    Update([&](SearchServer& server) {
+        server.AddDocument(document_id, document, status, ratings);
+    });
+}
+
+void VersionedSearchServer::AddDocuments(const std::vector<DocumentToAdd>& documents) {
+    AddDocuments(std::execution::seq, documents);
+}
+
+void VersionedSearchServer::RemoveDocument(int document_id) {
+    Update([document_id](SearchServer& server) {
+        server.RemoveDocument(document_id);
+    });
+}
+
+uint64_t VersionedSearchServer::GetVersion() const {
+    return version_.load();
+}
+
+void VersionedSearchServer::WaitForReaders(int read_indicator_index) const {
+    while (read_indicators_[read_indicator_index].load() != 0) {
+        std::this_thread::yield();
+    }
+}
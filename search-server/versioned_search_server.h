@@ -0,0 +1,118 @@
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <mutex>
+#include <vector>
+#include <string_view>
+#include <utility>
+
+#include "search_server.h"
+
+// SearchServer which can be modified while queries are running. Two copies of the index
+// are kept: readers pin the published copy and never wait, a writer changes the other copy,
+// publishes it, waits until the readers of the old copy are gone and repeats the change there
+// (the left-right technique). Readers always see the state before or after a whole change.
+class VersionedSearchServer {
+public:
+    template<typename... StopWords>
+    explicit VersionedSearchServer(const StopWords&... stop_words);
+
+    // Calls func with a consistent read-only view of the index. The view, and references or
+    // string views obtained from it, are valid only until func returns
+    template<typename Func>
+    auto Read(Func func) const;
+
+    // Applies func to the index as a single change. func is called once for each copy of
+    // the index and must change both the same way; if it throws on the first call nothing is changed
+    template<typename Func>
+    void Update(Func func);
+
+    template<typename... Args>
+    std::vector<Document> FindTopDocuments(const Args&... args) const;
+
+    int GetDocumentCount() const;
+
+    void AddDocument(int document_id, std::string_view document, DocumentStatus status, const std::vector<int>& ratings);
+
+    template<typename ExecutionPolicy>
+    void AddDocuments(const ExecutionPolicy& policy, const std::vector<DocumentToAdd>& documents);
+
+    void AddDocuments(const std::vector<DocumentToAdd>& documents);
+
+    void RemoveDocument(int document_id);
+
+    // Number of changes published so far
+    uint64_t GetVersion() const;
+
+private:
+    class ReadGuard {
+    public:
+        explicit ReadGuard(const VersionedSearchServer& server);
+        ~ReadGuard();
+
+        ReadGuard(const ReadGuard&) = delete;
+        ReadGuard& operator=(const ReadGuard&) = delete;
+
+        const SearchServer& GetServer() const;
+
+    private:
+        const VersionedSearchServer& server_;
+        int read_indicator_;
+        const SearchServer* search_server_;
+    };
+
+    std::array<SearchServer, 2> servers_;
+    // copy of the index used by new readers
+    std::atomic<int> published_{0};
+    // readers register in one of two counters, a writer switches new readers to the other
+    // counter and waits until the old one drains
+    std::atomic<int> read_indicator_index_{0};
+    mutable std::array<std::atomic<int>, 2> read_indicators_{};
+    std::atomic<uint64_t> version_{0};
+    std::mutex write_mutex_;
+
+    void WaitForReaders(int read_indicator_index) const;
+};
+
+template<typename... StopWords>
+VersionedSearchServer::VersionedSearchServer(const StopWords&... stop_words)
+    : servers_{SearchServer(stop_words...), SearchServer(stop_words...)} {
+}
+
+template<typename Func>
+auto VersionedSearchServer::Read(Func func) const {
+    ReadGuard guard(*this);
+    return func(guard.GetServer());
+}
+
+template<typename Func>
+void VersionedSearchServer::Update(Func func) {
+    std::lock_guard guard(write_mutex_);
+    const int published = published_.load();
+    func(servers_[1 - published]);
+    published_.store(1 - published);
+    ++version_;
+
+    // readers which could still see the old copy are registered in one of the indicators
+    const int read_indicator_index = read_indicator_index_.load();
+    WaitForReaders(1 - read_indicator_index);
+    read_indicator_index_.store(1 - read_indicator_index);
+    WaitForReaders(read_indicator_index);
+
+    func(servers_[published]);
+}
+
+template<typename... Args>
+std::vector<Document> VersionedSearchServer::FindTopDocuments(const Args&... args) const {
+    return Read([&](const SearchServer& server) {
+        return server.FindTopDocuments(args...);
+    });
+}
+
+template<typename ExecutionPolicy>
+void VersionedSearchServer::AddDocuments(const ExecutionPolicy& policy, const std::vector<DocumentToAdd>& documents) {
+    Update([&](SearchServer& server) {
+        server.AddDocuments(policy, documents);
+    });
+}